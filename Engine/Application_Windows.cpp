@@ -14,14 +14,17 @@
 #include <DxgiDebug.h>
 #include <math.h> // sinf, cosf
 #include <Windows.h>
+#include <Psapi.h> // QueryWorkingSetEx
 #include <wrl.h>
 #include <Xaudio2.h>
+#include <xmmintrin.h> // _mm_xxx
 
 #pragma comment(lib, "d3d12.lib")
 #pragma comment(lib, "d3dcompiler.lib")
 #pragma comment(lib, "Dbghelp.lib")
 #pragma comment(lib, "dxgi.lib")
 #pragma comment(lib, "dxguid.lib")
+#pragma comment(lib, "Psapi.lib")
 #pragma comment(lib, "Xaudio2.lib")
 
 #if defined(DEBUG)
@@ -30,6 +33,12 @@
 #define DEBUG_ONLY(A)
 #endif
 
+#if defined(DEBUG) || defined(PROFILE)
+#define PROFILE_ONLY(A) A
+#else
+#define PROFILE_ONLY(A)
+#endif
+
 #include "Math.h"
 #include "Interface.h"
 #include "Core_Windows.h"
@@ -40,6 +49,7 @@
 #include "Render_DirectX12.h"
 #include "Debug_DirectX12.h"
 #include "Debug.h"
+#include "Occlusion.h"
 #include "Engine.h"
 
 
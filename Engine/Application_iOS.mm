@@ -1,4 +1,5 @@
 
+#include <arm_neon.h> // vxxxq_f32
 #include <cstdarg> // va_start
 #include <cstdio> // printf, snprintf, vsnprintf
 #include <dirent.h>
@@ -33,6 +34,12 @@
 #define RELEASE_ONLY(A)
 #endif
 
+#if defined(DEBUG) || defined(PROFILE)
+#define PROFILE_ONLY(A) A
+#else
+#define PROFILE_ONLY(A)
+#endif
+
 #include "Math.h"
 #include "Interface.h"
 #include "Core_iOS.h"
@@ -44,6 +51,7 @@
 #include "Debug.h"
 #include "Audio_iOS.h"
 #include "Control_iOS.h"
+#include "Occlusion.h"
 #include "Engine.h"
 
 @interface Application : UIViewController <UIApplicationDelegate, MTKViewDelegate>
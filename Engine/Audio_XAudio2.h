@@ -59,8 +59,8 @@ class BankDynamic : public Bank {
     Bundle::Asset asset;
 
 public:
-    BankDynamic(uint64 id, const String& name)
-        : Bank(id, name) {}
+    BankDynamic(uint64 id)
+        : Bank(id) {}
 
     void Load(const Bundle& bundle, Surround& surround) {
         asset = bundle.FindData(Id());
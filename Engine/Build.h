@@ -6,8 +6,10 @@ const String CachePath() { return RootPath + String("Cache/"); }
 static const String AssetFilename(const String& name) { return AssetPath() + name + ".xml"; }
 static const String HeaderFilename(const String& name) { return name + ".header"; }
 static const String DataFilename(const String& name) { return name + ".data"; }
+static const String NamesFilename(const String& name) { return name + ".names"; }
 static const String CacheHeaderFilename(const String& name) { return CachePath() + HeaderFilename(name); }
 static const String CacheDataFilename(const String& name) { return CachePath() + DataFilename(name); }
+static const String CacheNamesFilename(const String& name) { return CachePath() + NamesFilename(name); }
 
 class Alloc { // TODO: Remove.
     void* mem = nullptr;
@@ -15,10 +17,10 @@ class Alloc { // TODO: Remove.
 
 public:
     Alloc() {}
-    Alloc(::size size) : mem(Memory::Malloc(size)), size(size) {}
-    Alloc(void* data, ::size size) : mem(Memory::Malloc(size)), size(size) { memcpy(mem, data, size); }
+    Alloc(::size size) : mem(Memory::Allocate(size, Memory::Tag::Build)), size(size) {}
+    Alloc(void* data, ::size size) : mem(Memory::Allocate(size, Memory::Tag::Build)), size(size) { memcpy(mem, data, size); }
     Alloc(Alloc& other) : mem(other.mem), size(other.size) { other.mem = nullptr; other.size = 0; }
-    ~Alloc() { Memory::Free(mem, size); }
+    ~Alloc() { Memory::Deallocate(mem, size, Memory::Tag::Build); }
 
     Alloc& operator=(Alloc& other) { mem = other.mem; size = other.size; other.mem = nullptr; other.size = 0; return *this; }
 
@@ -26,6 +28,104 @@ public:
     ::size Size() const { return size; }
 };
 
+class NameTable : public NoCopy { // Sized from the names about to be gathered, adding past that throws.
+    struct Entry {
+        uint64 id = 0;
+        String name;
+
+        Entry() {}
+        Entry(uint64 id, const String& name) : id(id), name(name) {}
+
+        bool operator>(const Entry& other) const { return id > other.id; }
+    };
+
+    Alloc alloc;
+    Entry* entries = nullptr;
+    unsigned count = 0;
+    unsigned capacity = 0;
+
+    template<typename F> void ProcessUnique(F func) const { // Skips adjacent duplicates once sorted.
+        uint64 last_id = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            if (entries[i].id != last_id)
+                func(entries[i]);
+            last_id = entries[i].id;
+        }
+    }
+
+public:
+    NameTable(unsigned capacity) : alloc(Math::Max(capacity, 1u) * sizeof(Entry)), entries((Entry*)alloc.Pointer()), capacity(capacity) {}
+
+    void Add(uint64 id, const String& name) {
+        if (count >= capacity) throw Exception("Name table is full");
+        new(&entries[count++]) Entry(id, name);
+    }
+
+    void Sort() { // Insertion sort, names are mostly gathered in order.
+        for (unsigned i = 1; i < count; ++i) {
+            const auto entry = entries[i];
+            unsigned j = i;
+            for (; (j > 0) && (entries[j - 1] > entry); --j)
+                entries[j] = entries[j - 1];
+            entries[j] = entry;
+        }
+    }
+
+    static unsigned CountFile(const String& filename) {
+        ReadOnlyFile file(filename);
+        return *(uint32*)file.Pointer();
+    }
+
+    unsigned Count() const {
+        unsigned count = 0;
+        ProcessUnique([&](const auto& entry) { count++; });
+        return count;
+    }
+
+    size StringsSize() const {
+        size size = 0;
+        ProcessUnique([&](const auto& entry) { size += entry.name.Size() + 1; });
+        return size;
+    }
+
+    uint8* WriteTable(uint8* out, size start) const {
+        size offset = start;
+        unsigned index = 0;
+        ProcessUnique([&](const auto& entry) {
+            ((Bundle::Resource*)out)[index++] = Bundle::Resource(entry.id, offset, entry.name.Size());
+            offset += entry.name.Size() + 1;
+        });
+        return out + index * sizeof(Bundle::Resource);
+    }
+
+    uint8* WriteStrings(uint8* out) const {
+        ProcessUnique([&](const auto& entry) {
+            memcpy(out, entry.name.Data(), entry.name.Size() + 1);
+            out += entry.name.Size() + 1;
+        });
+        return out;
+    }
+
+    void Write(const String& filename) const {
+        const unsigned count = Count();
+        const size metadata_size = sizeof(uint32) + count * sizeof(Bundle::Resource);
+        WriteOnlyFile file(filename, metadata_size + StringsSize());
+        auto* out = (uint8*)file.Pointer();
+        *(uint32*)out = count;
+        out = WriteTable(out + sizeof(uint32), metadata_size);
+        WriteStrings(out);
+    }
+
+    void Read(const String& filename) {
+        ReadOnlyFile file(filename);
+        const auto* in = (uint8*)file.Pointer();
+        const unsigned count = *(uint32*)in;
+        const auto* resources = (Bundle::Resource*)(in + sizeof(uint32));
+        for (unsigned i = 0; i < count; ++i)
+            Add(resources[i].data_id, String((char*)in + resources[i].offset, resources[i].length));
+    }
+};
+
 class BatchBuild {
 public:
     static const unsigned DataIndexMaxCount = 4;
@@ -49,8 +149,8 @@ private:
 
 public:
     ClusterBuild() {}
-    ClusterBuild(uint64 id, String& name, const Vector3& position, const Quaternion& rotation)
-        : Cluster(id, name, position, rotation) {}
+    ClusterBuild(uint64 id, const Vector3& position, const Quaternion& rotation)
+        : Cluster(id, position, rotation) {}
     ClusterBuild(const ClusterBuild& other) { memcpy(this, &other, sizeof(ClusterBuild)); }
 
     ClusterBuild& operator=(const ClusterBuild& other) { memcpy(this, &other, sizeof(ClusterBuild)); return *this; }
@@ -79,77 +179,81 @@ public:
 
 struct CellBuild : public Cell {
     static const unsigned ClusterMaxCount = 256; // TODO: Remove.
+    static const unsigned FollowRecordMaxCount = ClusterMaxCount * Cluster::BatchMaxCount;
 
-    CellBuild(uint64 id, const String& name) : Cell(id, name) {
+    CellBuild(uint64 id, const String& name) : Cell(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
         
         Alloc alloc(sizeof(Array<ClusterBuild, ClusterMaxCount>));
         auto& clusters_build = *(Array<ClusterBuild, ClusterMaxCount>*)alloc.Pointer();
-        ReadClusters(root, clusters_build);
-
-        cluster_count = clusters_build.UsedCount();
+        NameTable names(CountNames(root));
+        ReadClusters(root, clusters_build, names);
+        names.Write(CacheNamesFilename(name));
 
-        FixedArray<Alloc, Table::Count> allocs;
-        allocs[Table::Script] = Alloc(sizeof(Array<ScriptCluster, ClusterMaxCount>));
-        allocs[Table::Follow] = Alloc(sizeof(Array<FollowCluster, ClusterMaxCount>));
-        allocs[Table::Source] = Alloc(sizeof(Array<SourceCluster, ClusterMaxCount>));
-        allocs[Table::Camera] = Alloc(sizeof(Array<CameraCluster, ClusterMaxCount>));
-        allocs[Table::Render] = Alloc(sizeof(Array<RenderCluster, ClusterMaxCount>));
+        Alloc script_alloc(sizeof(Array<ScriptCluster, ClusterMaxCount>));
+        Alloc follow_alloc(sizeof(Array<FollowCluster, ClusterMaxCount>));
+        Alloc source_alloc(sizeof(Array<SourceCluster, ClusterMaxCount>));
+        Alloc camera_alloc(sizeof(Array<CameraCluster, ClusterMaxCount>));
+        Alloc render_alloc(sizeof(Array<RenderCluster, ClusterMaxCount>));
+        Alloc links_alloc(sizeof(Array<RenderLinks, ClusterMaxCount>));
+        Alloc records_alloc(sizeof(Array<FollowRecord, FollowRecordMaxCount>));
 
-        auto& script_clusters = *(Array<ScriptCluster, ClusterMaxCount>*)allocs[Table::Script].Pointer();
-        auto& follow_clusters = *(Array<FollowCluster, ClusterMaxCount>*)allocs[Table::Follow].Pointer();
-        auto& source_clusters = *(Array<SourceCluster, ClusterMaxCount>*)allocs[Table::Source].Pointer();
-        auto& camera_clusters = *(Array<CameraCluster, ClusterMaxCount>*)allocs[Table::Camera].Pointer();
-        auto& render_clusters = *(Array<RenderCluster, ClusterMaxCount>*)allocs[Table::Render].Pointer();
+        auto& script_clusters = *(Array<ScriptCluster, ClusterMaxCount>*)script_alloc.Pointer();
+        auto& follow_clusters = *(Array<FollowCluster, ClusterMaxCount>*)follow_alloc.Pointer();
+        auto& source_clusters = *(Array<SourceCluster, ClusterMaxCount>*)source_alloc.Pointer();
+        auto& camera_clusters = *(Array<CameraCluster, ClusterMaxCount>*)camera_alloc.Pointer();
+        auto& render_clusters = *(Array<RenderCluster, ClusterMaxCount>*)render_alloc.Pointer();
+        auto& render_links = *(Array<RenderLinks, ClusterMaxCount>*)links_alloc.Pointer();
+        auto& follow_records = *(Array<FollowRecord, FollowRecordMaxCount>*)records_alloc.Pointer();
 
-        ParseClusters(clusters_build, script_clusters, follow_clusters, source_clusters, camera_clusters, render_clusters);
+        ParseClusters(clusters_build, script_clusters, follow_clusters, source_clusters, camera_clusters, render_clusters, render_links, follow_records);
 
-        cluster_tables[Table::Script] = Table((uint32)(sizeof(ScriptCluster) + Cluster::DynamicSize), script_clusters.UsedCount());
-        cluster_tables[Table::Follow] = Table((uint32)(sizeof(FollowCluster) + Cluster::DynamicSize), follow_clusters.UsedCount());
-        cluster_tables[Table::Source] = Table((uint32)(sizeof(SourceCluster) + Cluster::DynamicSize), source_clusters.UsedCount());
-        cluster_tables[Table::Camera] = Table((uint32)(sizeof(CameraCluster) + Cluster::DynamicSize), camera_clusters.UsedCount());
-        cluster_tables[Table::Render] = Table((uint32)(sizeof(RenderCluster) + Cluster::DynamicSize), render_clusters.UsedCount());
+        WriteClusters(name, clusters_build, script_clusters, follow_clusters, source_clusters, camera_clusters, render_clusters, render_links, follow_records);
+    }
 
-        WriteClusters(clusters_build, script_clusters, follow_clusters, source_clusters, camera_clusters, render_clusters);
+    template <typename C, size N> static size TableSize(const Array<C, N>& clusters) {
+        return Arena::AlignSize(clusters.UsedCount() * sizeof(C));
     }
 
-    void WriteClusters(const Array<ClusterBuild, ClusterMaxCount>& clusters_build,
+    void WriteClusters(const String& name, const Array<ClusterBuild, ClusterMaxCount>& clusters_build,
             const Array<ScriptCluster, ClusterMaxCount>& script_clusters,
             const Array<FollowCluster, ClusterMaxCount>& follow_clusters,
             const Array<SourceCluster, ClusterMaxCount>& source_clusters,
             const Array<CameraCluster, ClusterMaxCount>& camera_clusters,
-            const Array<RenderCluster, ClusterMaxCount>& render_clusters) {
-        size total_size = sizeof(Cluster) * clusters_build.UsedCount();
-        cluster_tables.ConstProcess([&](auto& table) {
-            total_size += table.TotalSize();
-        });
-        WriteOnlyFile data_file(CacheDataFilename(Name()), total_size);
+            const Array<RenderCluster, ClusterMaxCount>& render_clusters,
+            const Array<RenderLinks, ClusterMaxCount>& render_links,
+            const Array<FollowRecord, FollowRecordMaxCount>& follow_records) {
+        const size total_size = Arena::AlignSize(sizeof(Image)) + Arena::AlignSize(clusters_build.UsedCount() * sizeof(Cluster)) +
+            TableSize(script_clusters) + TableSize(follow_clusters) + TableSize(source_clusters) + TableSize(camera_clusters) + TableSize(render_clusters) + TableSize(render_links) +
+            TableSize(follow_records);
+        WriteOnlyFile data_file(CacheDataFilename(name), total_size);
         auto* out = (uint8*)data_file.Pointer();
-        size offset = 0;
+        auto& image = *new(out) Image();
+        size offset = Arena::AlignSize(sizeof(Image));
 
-        cluster_offset = (uint32)offset;
-        clusters_build.ConstProcess([&](auto& cluster_build) {
-            memcpy(&out[offset], &cluster_build, sizeof(Cluster));
-            offset += sizeof(Cluster);
+        auto* clusters = (Cluster*)&out[offset];
+        clusters_build.ConstProcessIndex([&](auto& cluster_build, unsigned index) {
+            memcpy(&clusters[index], &cluster_build, sizeof(Cluster));
         });
+        image.clusters.Set(clusters, clusters_build.UsedCount());
+        offset += Arena::AlignSize(clusters_build.UsedCount() * sizeof(Cluster));
 
-        WriteClusterTable(script_clusters, cluster_tables[Table::Script], out, offset);
-        WriteClusterTable(follow_clusters, cluster_tables[Table::Follow], out, offset);
-        WriteClusterTable(source_clusters, cluster_tables[Table::Source], out, offset);
-        WriteClusterTable(camera_clusters, cluster_tables[Table::Camera], out, offset);
-        WriteClusterTable(render_clusters, cluster_tables[Table::Render], out, offset);
+        WriteClusterTable(script_clusters, image.script_clusters, out, offset);
+        WriteClusterTable(follow_clusters, image.follow_clusters, out, offset);
+        WriteClusterTable(source_clusters, image.source_clusters, out, offset);
+        WriteClusterTable(camera_clusters, image.camera_clusters, out, offset);
+        WriteClusterTable(render_clusters, image.render_clusters, out, offset);
+        WriteClusterTable(render_links, image.render_links, out, offset);
+        WriteClusterTable(follow_records, image.follow_records, out, offset);
     }
 
-    template <typename C> void WriteClusterTable(const Array<C, ClusterMaxCount>& clusters, Table& table, uint8* out, size& offset) {
-        table.offset = (uint32)offset;
-        clusters.ConstProcess([&](auto& cluster) {
-            memcpy(&out[offset], &cluster, sizeof(C));
-            offset += sizeof(C);
-            memset(&out[offset], 0, Cluster::DynamicSize);
-            offset += Cluster::DynamicSize;
-        });
+    template <typename C, size N> void WriteClusterTable(const Array<C, N>& clusters, RelArray<C>& table, uint8* out, size& offset) {
+        auto* values = (C*)&out[offset];
+        memcpy(values, clusters.Values(), clusters.UsedCount() * sizeof(C));
+        table.Set(values, clusters.UsedCount());
+        offset += TableSize(clusters);
     }
 
     void ParseClusters(const Array<ClusterBuild, ClusterMaxCount>& clusters_build,
@@ -157,8 +261,10 @@ struct CellBuild : public Cell {
             Array<FollowCluster, ClusterMaxCount>& follow_clusters,
             Array<SourceCluster, ClusterMaxCount>& source_clusters,
             Array<CameraCluster, ClusterMaxCount>& camera_clusters,
-            Array<RenderCluster, ClusterMaxCount>& render_clusters) {
-        clusters_build.ConstProcess([&](auto& cluster_build) {
+            Array<RenderCluster, ClusterMaxCount>& render_clusters,
+            Array<RenderLinks, ClusterMaxCount>& render_links,
+            Array<FollowRecord, FollowRecordMaxCount>& follow_records) {
+        clusters_build.ConstProcessIndex([&](auto& cluster_build, unsigned cluster_index) {
             uint64 bank_id = 0;
             uint64 camera_id = 0;
             uint64 flags_id = 0;
@@ -184,13 +290,13 @@ struct CellBuild : public Cell {
             Array<uint64, Cluster::BatchMaxCount> mesh_ids;
             Array<uint64, Cluster::BatchMaxCount> uniforms_ids;
 
-            cluster_build.BatchesBuild().ConstProcess([&](auto& batch_build) {
+            cluster_build.BatchesBuild().ConstProcessIndex([&](auto& batch_build, unsigned batch_index) {
                 uint64 uniforms_id = 0;
                 uint64 mesh_id = 0;
                 batch_build.DataIndices().ConstProcess([&](auto& data_index) {
                     const auto data_id = cluster_build.DataIds()[data_index];
                     switch (Data::DataTypeFromId(data_id)) {
-                    case Data::Type::Follow: follow_ids.Add(data_id); break;
+                    case Data::Type::Follow: follow_ids.Add(data_id); follow_records.Add(data_id, cluster_index, batch_index); break;
                     case Data::Type::Mesh: mesh_id = data_id; break;
                     case Data::Type::Source: source_ids.Add(data_id); break;
                     case Data::Type::Uniforms: uniforms_id = data_id; break;
@@ -204,29 +310,30 @@ struct CellBuild : public Cell {
             });
 
             if (script_id) {
-                script_clusters.Add(cluster_build.Id(), script_id);
+                script_clusters.Add(cluster_build.Id(), cluster_index, script_id);
             }
 
             if (follow_ids.UsedCount() > 0) {
-                auto& follow_cluster = follow_clusters.Add(cluster_build.Id());
+                auto& follow_cluster = follow_clusters.Add(cluster_build.Id(), cluster_index);
                 follow_ids.ConstProcess([&](const auto& follow_id) {
                     follow_cluster.AddFollowId(follow_id);
                 });
             }
 
             if (source_ids.UsedCount() > 0) {
-                auto& source_cluster = source_clusters.Add(cluster_build.Id(), bank_id);
+                auto& source_cluster = source_clusters.Add(cluster_build.Id(), cluster_index, bank_id);
                 source_ids.ConstProcess([&](const auto& source_id) {
                     source_cluster.AddSourceId(source_id);
                 });
             }
 
             if (camera_id) {
-                camera_clusters.Add(cluster_build.Id(), camera_id);
+                camera_clusters.Add(cluster_build.Id(), cluster_index, camera_id);
             }
 
             if (shader_id) {
-                render_clusters.Add(cluster_build.Id(), flags_id, shader_id, surface_ids, camera_id != 0, mesh_ids, uniforms_ids);
+                render_clusters.Add(cluster_build.Id(), cluster_index, camera_id != 0);
+                render_links.Add(cluster_build.Id(), cluster_index, flags_id, shader_id, surface_ids, mesh_ids, uniforms_ids);
             }
         });
         script_clusters.Sort();
@@ -234,9 +341,20 @@ struct CellBuild : public Cell {
         source_clusters.Sort();
         camera_clusters.Sort();
         render_clusters.Sort();
+        render_links.Sort();
+    }
+
+    static unsigned CountNames(const XML::Node* root) { // One per cluster and batch.
+        unsigned count = 0;
+        for (auto* node = root->FirstNode("cluster"); node; node = node->NextSibling("cluster")) {
+            count++;
+            for (auto* batch = node->FirstNode("batch"); batch; batch = batch->NextSibling("batch"))
+                count++;
+        }
+        return count;
     }
 
-    void ReadClusters(const XML::Node* root, Array<ClusterBuild, ClusterMaxCount>& clusters_build) {
+    void ReadClusters(const XML::Node* root, Array<ClusterBuild, ClusterMaxCount>& clusters_build, NameTable& names) {
         auto* node = root->FirstNode("cluster");
         while (node) {
             auto cluster_name = node->Text("name");
@@ -248,23 +366,26 @@ struct CellBuild : public Cell {
             rotation = rotation.Normalize();
 
             auto& cluster = clusters_build.Add();
-            new(&cluster) ClusterBuild(cluster_id, cluster_name, position, rotation);
+            new(&cluster) ClusterBuild(cluster_id, position, rotation);
+            names.Add(cluster_id, cluster_name);
             ReadClusterDatas(node, cluster);
-            ReadClusterBatches(node, cluster);
+            ReadClusterBatches(node, cluster, names);
             cluster.ComputeBounds();
+            cluster.IndexBatches();
             node = node->NextSibling("cluster");
         }
         clusters_build.Sort();
     }
 
-    void ReadClusterBatches(const XML::Node* parent, ClusterBuild& cluster_build) {
+    void ReadClusterBatches(const XML::Node* parent, ClusterBuild& cluster_build, NameTable& names) {
         auto node = parent->FirstNode("batch");
         while (node) {
             auto name = node->Text("name");
             const uint64 id = node->Hash64("name");
             Vector3 extents;
             node->Vec3(&extents.x, "extents", 1.f);
-            ReadBatchInstances(node, cluster_build.Batches().Add(id, name, extents));
+            ReadBatchInstances(node, cluster_build.Batches().Add(id, extents));
+            names.Add(id, name);
             ReadBatchDatas(node, cluster_build, cluster_build.BatchesBuild().Add());
             node = node->NextSibling("batch");
         }
@@ -332,23 +453,44 @@ struct CellBuild : public Cell {
 };
 
 struct DictionaryBuild : public Dictionary {
-    DictionaryBuild(uint64 id, const String& name) : Dictionary(id, name) {
+    DictionaryBuild(uint64 id, const String& name) : Dictionary(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
 
+        for (auto node = root->FirstNode("entry"); node; node = node->NextSibling("entry"))
+            entry_count++;
+
+        uint32 slot_count = 1;
+        while (slot_count < entry_count * 2)
+            slot_count *= 2;
+        slot_mask = slot_count - 1;
+
+        WriteOnlyFile data_file(CacheDataFilename(name), slot_count * sizeof(Entry));
+        auto* slots = new(data_file.Pointer()) Entry[slot_count];
         auto node = root->FirstNode("entry");
         while (node) {
-            auto name = node->Hash32("name");
-            auto value = node->Float("value", 0.0f);
-            entries.Add(name, value);
+            Insert(slots, node->Hash32("name"), node->Float("value", 0.0f));
             node = node->NextSibling("entry");
         }
     }
+
+    void Insert(Entry* slots, uint32 hash, float value) {
+        if (hash == 0) throw Exception("Dictionary entry name cannot hash to 0");
+        for (uint32 i = 0; i <= slot_mask; ++i) {
+            auto& slot = slots[(hash + i) & slot_mask];
+            if ((slot.hash == 0) || (slot.hash == hash)) { // Duplicates keep the last value.
+                slot = Entry(hash, value);
+                probe_max_count = Math::Max(probe_max_count, i + 1);
+                return;
+            }
+        }
+        throw Exception("Dictionary is full");
+    }
 };
 
 struct FollowBuild : public Follow {
-    FollowBuild(uint64 id, const String& name) : Follow(id, name) {
+    FollowBuild(uint64 id, const String& name) : Follow(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -359,9 +501,6 @@ struct FollowBuild : public Follow {
         rotation_speed = root->Float("rot_speed", 1.f);
         followed_cluster_id = root->Hash64("cluster");
         followed_batch_id = root->Hash64("batch");
-        bucket_index = root->Int("bucket", 0);
-        if (bucket_index >= Follow::BucketMaxCount)
-            throw Exception("Invalid bucket index");
         type = ReadType(root);
     }
 
@@ -375,7 +514,7 @@ struct FollowBuild : public Follow {
 };
 
 struct SourceBuild : public Source {
-    SourceBuild(uint64 id, const String& name) : Source(id, name) {
+    SourceBuild(uint64 id, const String& name) : Source(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         //auto root = doc.FirstNode();
@@ -383,7 +522,7 @@ struct SourceBuild : public Source {
 };
 
 struct FlagsBuild : public Flags {
-    FlagsBuild(uint64 id, const String& name) : Flags(id, name) {
+    FlagsBuild(uint64 id, const String& name) : Flags(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -397,7 +536,7 @@ struct FlagsBuild : public Flags {
 };
 
 struct UniformsBuild : public Uniforms {
-    UniformsBuild(uint64 id, const String& name) : Uniforms(id, name) {
+    UniformsBuild(uint64 id, const String& name) : Uniforms(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -422,7 +561,7 @@ struct UniformsBuild : public Uniforms {
 };
 
 struct CameraBuild : public Camera {
-    CameraBuild(uint64 id, const String& name) : Camera(id, name) {
+    CameraBuild(uint64 id, const String& name) : Camera(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -432,17 +571,21 @@ struct CameraBuild : public Camera {
         persp_near = root->Float("near", 0.1f);
         persp_far = root->Float("far", 1000.f);
         root->Vec2(&ortho_width, "ortho", 0.f);
-        ReadTargets(root);
+
+        WriteOnlyFile data_file(CacheDataFilename(name), sizeof(Array<TargetLinks, TargetMaxCount>));
+        auto& target_links = *new(data_file.Pointer()) Array<TargetLinks, TargetMaxCount>();
+        ReadTargets(root, target_links);
     }
 
-    void ReadPasses(Target& target, const XML::Node* parent) {
+    void ReadPasses(Target& target, TargetLinks& target_links, const XML::Node* parent) {
         auto node = parent->FirstNode("pass");
         while (node) {
             Pass& pass = target.passes.Add();
-            ReadShader(pass, node);
-            ReadMesh(pass, node);
-            ReadSurfaces(pass, node);
-            ReadUniforms(pass, node);
+            PassLinks& pass_links = target_links.passes.Add();
+            ReadShader(pass_links, node);
+            ReadMesh(pass_links, node);
+            ReadSurfaces(pass_links, node);
+            ReadUniforms(pass_links, node);
             pass.technique_id = node->Hash32("technique");
             node->Color(pass.profile, "profile", 0);
             ReadIncludes(pass, node);
@@ -451,32 +594,32 @@ struct CameraBuild : public Camera {
         }
     }
 
-    void ReadShader(Pass& pass, const XML::Node* parent) {
+    void ReadShader(PassLinks& pass_links, const XML::Node* parent) {
         auto node = parent->FirstNode("shader");
         if (node) {
-            pass.auto_shader_id = IdFromName(node->Text("name"));
+            pass_links.auto_shader_id = IdFromName(node->Text("name"));
         }
     }
 
-    void ReadMesh(Pass& pass, const XML::Node* parent) {
+    void ReadMesh(PassLinks& pass_links, const XML::Node* parent) {
         auto node = parent->FirstNode("mesh");
         if (node) {
-            pass.auto_mesh_id = IdFromName(node->Text("name"));
+            pass_links.auto_mesh_id = IdFromName(node->Text("name"));
         }
     }
 
-    void ReadSurfaces(Pass& pass, const XML::Node* parent) {
+    void ReadSurfaces(PassLinks& pass_links, const XML::Node* parent) {
         auto node = parent->FirstNode("surface");
         while (node) {
-            pass.auto_surface_ids.Add(IdFromName(node->Text("name")));
+            pass_links.auto_surface_ids.Add(IdFromName(node->Text("name")));
             node = node->NextSibling("surface");
         }
     }
 
-    void ReadUniforms(Pass& pass, const XML::Node* parent) {
+    void ReadUniforms(PassLinks& pass_links, const XML::Node* parent) {
         auto node = parent->FirstNode("uniforms");
         if (node) {
-            pass.auto_uniforms_id = IdFromName(node->Text("name"));
+            pass_links.auto_uniforms_id = IdFromName(node->Text("name"));
         }
     }
 
@@ -496,46 +639,47 @@ struct CameraBuild : public Camera {
         }
     }
 
-    void ReadTargets(const XML::Node* parent) {
+    void ReadTargets(const XML::Node* parent, Array<TargetLinks, TargetMaxCount>& target_links) {
         auto node = parent->FirstNode("target");
         while (node) {
             Target& target = targets.Add();
+            TargetLinks& links = target_links.Add();
             target.target_id = node->Hash32("name");
             target.clear_color = node->Bool("clear_color", true);
             target.clear_depth = node->Bool("clear_depth", true);
             target.last = node->Bool("last", false);
-            ReadColorAttachments(target, node);
-            ReadDepthStencilAttachment(target, node);
-            ReadPasses(target, node);
-            if ((target.color_attachment_ids.UsedCount() == 0) && (target.depth_stencil_attachment_id == 0))
+            ReadColorAttachments(links, node);
+            ReadDepthStencilAttachment(links, node);
+            ReadPasses(target, links, node);
+            if ((links.color_attachment_ids.UsedCount() == 0) && (links.depth_stencil_attachment_id == 0))
                 throw Exception("Should have at least 1 attachment");
             node = node->NextSibling("target");
         }
     }
 
-    void ReadColorAttachments(Target& target, const XML::Node* parent) {
+    void ReadColorAttachments(TargetLinks& target_links, const XML::Node* parent) {
         auto node = parent->FirstNode("color");
         while (node) {
             auto name = node->Text("name");
             if (DataTypeFromName(name) != Data::Type::Surface)
                 throw Exception("Attachment name must have an surface type");
-            target.color_attachment_ids.Add(IdFromName(name));
+            target_links.color_attachment_ids.Add(IdFromName(name));
             node = node->NextSibling("color");
         }
     }
 
-    void ReadDepthStencilAttachment(Target& target, const XML::Node* parent) {
+    void ReadDepthStencilAttachment(TargetLinks& target_links, const XML::Node* parent) {
         if (auto node = parent->FirstNode("depth")) {
             auto name = node->Text("name");
             if (DataTypeFromName(name) != Data::Type::Surface)
                 throw Exception("Attachment name must have an surface type");
-            target.depth_stencil_attachment_id = IdFromName(name);
+            target_links.depth_stencil_attachment_id = IdFromName(name);
         }
     }
 };
 
 struct BankBuild : public Bank {
-    BankBuild(uint64 id, const String& name) : Bank(id, name) {
+    BankBuild(uint64 id, const String& name) : Bank(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -562,6 +706,7 @@ struct BankBuild : public Bank {
             wav_files.Add(wav_filename);
             wavs.Add((uint8*)wav_files.Back().Pointer(), wav_files.Back().Size());
             sounds.Add(Hash::Fnv32(name.Data()), (char*)&wavs.Back().wfxt, sizeof(WAV::WAVEFORMATEXTENSIBLE), total_data_size, wavs.Back().Length());
+            sound_index.Add(sounds.Back().Id(), sounds.UsedCount() - 1);
             total_data_size += wavs.Back().Length();
             node = node->NextSibling("sound");
         }
@@ -570,7 +715,7 @@ struct BankBuild : public Bank {
 static_assert(sizeof(WAV::WAVEFORMATEXTENSIBLE) <= Bank::SoundFormatMaxSize);
 
 struct ScriptBuild : public Script {
-    ScriptBuild(uint64 id, const String& name) : Script(id, name) {
+    ScriptBuild(uint64 id, const String& name) : Script(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
@@ -583,8 +728,11 @@ struct ScriptBuild : public Script {
 };
 
 struct MeshBuild : public Mesh {
-    MeshBuild(uint64 id, const String& name) : Mesh(id, name) {
+    MeshBuild(uint64 id, const String& name) : Mesh(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
+        XML::Doc doc((char*)xml_file.Pointer());
+        auto root = doc.FirstNode();
+        occluder = root->Bool("occluder", false);
 
         ReadOnlyFile ply_file(AssetPath() + name + ".ply");
 
@@ -624,10 +772,135 @@ struct MeshBuild : public Mesh {
         const size vertices_size = vertex_size * vertex_count;
         const size indices_size = index_size * index_count;
 
-        WriteOnlyFile data_file(CacheDataFilename(name), vertices_size + indices_size);
-        OutputVertices(vertex_size, has_position, has_normals, has_texcoords0, has_colors0, x, y, z, nx, ny, nz, s, t, r, g, b, (uint8*)data_file.Pointer());
-        OutputIndices(attribute_type, index, (uint8*)data_file.Pointer() + vertices_size);
+        Alloc geometry(vertices_size + indices_size);
+        OutputVertices(vertex_size, has_position, has_normals, has_texcoords0, has_colors0, x, y, z, nx, ny, nz, s, t, r, g, b, (uint8*)geometry.Pointer());
+        OutputIndices(attribute_type, index, (uint8*)geometry.Pointer() + vertices_size);
         FillAttributes(vertex_size, index_size, attribute_type, vertices_size, has_position, has_normals, has_texcoords0, has_colors0, vertices_offset, normals_offset, texcoords0_offset, colors0_offset);
+
+        const unsigned triangle_count = has_position ? index_count / 3 : 0;
+        Alloc triangles(Math::Max(triangle_count, 1u) * sizeof(Triangle));
+        Alloc nodes((triangle_count + 1) * sizeof(TreeNode));
+        GatherTriangles((const uint8*)geometry.Pointer(), vertex_size, (const uint8*)geometry.Pointer() + vertices_size, index_size, (Triangle*)triangles.Pointer(), triangle_count);
+        if (triangle_count > 0)
+            BuildTreeNode((TreeNode*)nodes.Pointer(), (Triangle*)triangles.Pointer(), 0, triangle_count, 0);
+
+        tree_offset = (uint32)Math::AlignSize(vertices_size + indices_size, (size)16);
+        triangles_offset = tree_offset + tree_node_count * (uint32)sizeof(TreeNode);
+        WriteOnlyFile data_file(CacheDataFilename(name), triangles_offset + triangle_count * sizeof(Triangle));
+        memcpy(data_file.Pointer(), geometry.Pointer(), vertices_size + indices_size);
+        memcpy((uint8*)data_file.Pointer() + tree_offset, nodes.Pointer(), tree_node_count * sizeof(TreeNode));
+        memcpy((uint8*)data_file.Pointer() + triangles_offset, triangles.Pointer(), triangle_count * sizeof(Triangle));
+    }
+
+    static const unsigned TreeLeafMaxCount = 4;
+    static const unsigned TreeMaxDepth = 20;
+
+    void GatherTriangles(const uint8* vertices, size vertex_size, const uint8* indices, size index_size, Triangle* out_triangles, unsigned triangle_count) const {
+        if (triangle_count >= TreeNode::LeafFirstMask) throw Exception("Too many triangles for the mesh tree");
+        const auto position = [&](unsigned i) {
+            const uint32 vertex_index = index_size == sizeof(uint32) ? ((const uint32*)indices)[i] : ((const uint16*)indices)[i];
+            if (vertex_index >= vertex_count) throw Exception("Out-of-bounds vertex index");
+            return *(const Vector3*)(vertices + vertex_index * vertex_size);
+        };
+        for (unsigned i = 0; i < triangle_count; ++i)
+            out_triangles[i] = Triangle(position(i * 3 + 0), position(i * 3 + 1), position(i * 3 + 2));
+        for (unsigned i = 0; i < triangle_count * 3; ++i)
+            extents = extents.Maximum(position(i).Absolute());
+    }
+
+    static float Centroid(const Triangle& triangle, unsigned axis) { return (&triangle.a.x)[axis] + (&triangle.b.x)[axis] + (&triangle.c.x)[axis]; }
+
+    static void SelectMedian(Triangle* triangles, unsigned count, unsigned axis) { // Quickselect, the lower half ends up below the upper half along the axis.
+        int lo = 0, hi = (int)count - 1;
+        const int median = (int)count / 2;
+        while (lo < hi) {
+            const float pivot = Centroid(triangles[(lo + hi) / 2], axis);
+            int i = lo, j = hi;
+            while (i <= j) {
+                while (Centroid(triangles[i], axis) < pivot) i++;
+                while (Centroid(triangles[j], axis) > pivot) j--;
+                if (i <= j) {
+                    const Triangle swap = triangles[i];
+                    triangles[i++] = triangles[j];
+                    triangles[j--] = swap;
+                }
+            }
+            if (median <= j) hi = j;
+            else if (median >= i) lo = i;
+            else break;
+        }
+    }
+
+    static void Split(Triangle* triangles, unsigned first, unsigned count) { // Median cut along the longest centroid axis.
+        Aabb centroids;
+        for (unsigned i = first; i < first + count; ++i) {
+            const auto center = triangles[i].a + triangles[i].b + triangles[i].c;
+            centroids = centroids.Merge(Aabb(center, center));
+        }
+        const auto extent = centroids.max - centroids.min;
+        const unsigned axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+        SelectMedian(triangles + first, count, axis);
+    }
+
+    static void Quantize(TreeNode& node, unsigned i, const Aabb& box) {
+        const float lows[3] = { box.min.x, box.min.y, box.min.z };
+        const float highs[3] = { box.max.x, box.max.y, box.max.z };
+        uint8* mins[3] = { node.min_x, node.min_y, node.min_z };
+        uint8* maxs[3] = { node.max_x, node.max_y, node.max_z };
+        for (unsigned axis = 0; axis < 3; ++axis) {
+            const float origin = (&node.origin.x)[axis];
+            const float scale = (&node.scale.x)[axis];
+            int q_min = scale > 0.f ? (int)Math::Floor(Math::Clamp((lows[axis] - origin) / scale, 0.f, 255.f)) : 0;
+            int q_max = scale > 0.f ? (int)-Math::Floor(-Math::Clamp((highs[axis] - origin) / scale, 0.f, 255.f)) : 0;
+            while ((q_min > 0) && (origin + (float)q_min * scale > lows[axis])) q_min--; // Rounding never shrinks the box.
+            while ((q_max < 255) && (origin + (float)q_max * scale < highs[axis])) q_max++;
+            mins[axis][i] = (uint8)q_min;
+            maxs[axis][i] = (uint8)q_max;
+        }
+    }
+
+    unsigned BuildTreeNode(TreeNode* nodes, Triangle* triangles, unsigned first, unsigned count, unsigned depth) { // Four-wide, each node splits its range twice.
+        if (depth > TreeMaxDepth) throw Exception("Mesh tree is too deep");
+        const unsigned node_index = tree_node_count++;
+        unsigned begins[4] = { first };
+        unsigned counts[4] = { count };
+        unsigned range_count = 1;
+        while (range_count < 4) {
+            unsigned largest = 0;
+            for (unsigned i = 1; i < range_count; ++i)
+                if (counts[i] > counts[largest])
+                    largest = i;
+            if (counts[largest] <= TreeLeafMaxCount)
+                break;
+            Split(triangles, begins[largest], counts[largest]);
+            const unsigned half = counts[largest] / 2;
+            begins[range_count] = begins[largest] + half;
+            counts[range_count] = counts[largest] - half;
+            counts[largest] = half;
+            range_count++;
+        }
+
+        Aabb boxes[4];
+        Aabb node_box;
+        uint32 children[4] = {};
+        for (unsigned i = 0; i < range_count; ++i) {
+            for (unsigned j = begins[i]; j < begins[i] + counts[i]; ++j)
+                boxes[i] = boxes[i].Merge(triangles[j].BoundingBox());
+            node_box = node_box.Merge(boxes[i]);
+            children[i] = counts[i] <= TreeLeafMaxCount ?
+                TreeNode::LeafBit | (counts[i] << TreeNode::LeafCountShift) | begins[i] :
+                BuildTreeNode(nodes, triangles, begins[i], counts[i], depth + 1);
+        }
+
+        auto& node = nodes[node_index];
+        memset(&node, 0, sizeof(TreeNode));
+        node.origin = node_box.min;
+        node.scale = (node_box.max - node_box.min) * (1.0001f / 255.f);
+        for (unsigned i = 0; i < range_count; ++i) {
+            Quantize(node, i, boxes[i]);
+            node.children[i] = children[i];
+        }
+        return node_index;
     }
 
     size ComputeVertexSize(bool has_position, const bool has_normals, const bool has_texcoords0, bool has_colors0,
@@ -723,7 +996,7 @@ struct MeshBuild : public Mesh {
 };
 
 struct ShaderBuild : public Shader {
-    ShaderBuild(uint64 id, const String& name) : Shader(id, name) {
+    ShaderBuild(uint64 id, const String& name) : Shader(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
 
         XML::Doc doc((char*)xml_file.Pointer());
@@ -758,6 +1031,7 @@ struct ShaderBuild : public Shader {
         while (node) {
             auto& technique = techniques.Add();
             ReadTechnique(node, technique);
+            technique_index.Add(technique.ID(), techniques.UsedCount() - 1);
             node = node->NextSibling("technique");
         }
         if (techniques.UsedCount() == 0) throw Exception("Should have at least 1 technique");
@@ -927,22 +1201,22 @@ struct ShaderBuild : public Shader {
 };
 
 struct SurfaceBuild : public Surface {
-    SurfaceBuild(uint64 id, const String& name) : Surface(id, name) {
+    SurfaceBuild(uint64 id, const String& name) : Surface(id) {
         ReadOnlyFile xml_file(AssetFilename(name));
         XML::Doc doc((char*)xml_file.Pointer());
         auto root = doc.FirstNode();
 
         is_texture = root->Bool("texture", false);
         if (is_texture) {
-            ReadTexture(root);
+            ReadTexture(name, root);
         } else {
             ReadAttachment(root);
         }
     }
 
-    void ReadTexture(const XML::Node* parent) {
+    void ReadTexture(const String& name, const XML::Node* parent) {
         const bool mips = parent->Bool("mips", true);
-        Convert(mips);
+        Convert(name, mips);
     }
 
     void ReadAttachment(const XML::Node* parent) {
@@ -975,7 +1249,7 @@ struct SurfaceBuild : public Surface {
         throw Exception("Invalid 'format' XML attribute");
     }
 
-    void Convert(bool mips);
+    void Convert(const String& name, bool mips);
 };
 
 class Builder : public NoCopy {
@@ -1080,29 +1354,207 @@ class Packager : public NoCopy {
         bool operator>(const Resource& other) const { return data_id > other.data_id; }
     };
 
-    void GatherFolder(const String& path, Array<Resource, ResourceMaxCount>& headers, Array<Resource, ResourceMaxCount>& datas) {
+    void GatherFolder(const String& path, Array<Resource, ResourceMaxCount>& headers, Array<Resource, ResourceMaxCount>& datas, NameTable& names) {
         Directory::ProcessFiles(path.Data(), [&](const String& filename) {
             auto name = path.SubString(CachePath().Size()) + filename;
             if (filename.EndsWith(".data"))
                 datas.Add(Data::IdFromName(name.SubString(0, name.Size() - 5)), path + filename);
+            else if (filename.EndsWith(".names"))
+                names.Read(path + filename);
+            else if (filename.EndsWith(".header")) {
+                const auto data_name = name.SubString(0, name.Size() - 7);
+                headers.Add(Data::IdFromName(data_name), path + filename);
+                names.Add(Data::IdFromName(data_name), data_name);
+            }
+        });
+    }
+
+    static unsigned CountFolderNames(const String& path) {
+        unsigned count = 0;
+        Directory::ProcessFiles(path.Data(), [&](const String& filename) {
+            if (filename.EndsWith(".names"))
+                count += NameTable::CountFile(path + filename);
             else if (filename.EndsWith(".header"))
-                headers.Add(Data::IdFromName(name.SubString(0, name.Size() - 7)), path + filename);
+                count++;
+        });
+        return count;
+    }
+
+    static unsigned CountNames() {
+        unsigned count = CountFolderNames(CachePath());
+        Directory::ProcessFolders(CachePath().Data(), [&](const String& path) {
+            count += CountFolderNames(path);
         });
+        return count;
     }
 
-    void Gather(Array<Resource, ResourceMaxCount>& headers, Array<Resource, ResourceMaxCount>& datas) {
-        GatherFolder(CachePath(), headers, datas);
+    void Gather(Array<Resource, ResourceMaxCount>& headers, Array<Resource, ResourceMaxCount>& datas, NameTable& names) {
+        GatherFolder(CachePath(), headers, datas, names);
         Directory::ProcessFolders(CachePath().Data(), [&](const String& path) {
-            GatherFolder(path, headers, datas);
+            GatherFolder(path, headers, datas, names);
         });
         headers.Sort();
         datas.Sort();
+        names.Sort();
+    }
+
+    static DataHandle FindHandle(const Array<Resource, ResourceMaxCount>& headers, uint64 data_id) {
+        if (data_id == 0)
+            return InvalidDataHandle;
+        DataHandle handle = InvalidDataHandle;
+        headers.ConstProcessIndex([&](auto& resource, unsigned index) {
+            if (resource.data_id == data_id)
+                handle = (DataHandle)index;
+        });
+        return handle;
+    }
+
+    template <size N> static void LinkHandles(const Array<Resource, ResourceMaxCount>& headers, const Array<uint64, N>& ids, Array<DataHandle, N>& handles) {
+        handles.Clear();
+        ids.ConstProcess([&](auto& id) {
+            handles.Add(FindHandle(headers, id));
+        });
+    }
+
+    void LinkCell(const Array<Resource, ResourceMaxCount>& headers, Cell::Image& image) {
+        image.render_links.ConstProcessIndex([&](auto& links, unsigned index) {
+            auto& render_cluster = image.render_clusters[index];
+            render_cluster.flags = FindHandle(headers, links.flags_id);
+            render_cluster.shader = FindHandle(headers, links.shader_id);
+            LinkHandles(headers, links.surface_ids, render_cluster.surfaces);
+            LinkHandles(headers, links.mesh_ids, render_cluster.meshes);
+            LinkHandles(headers, links.uniforms_ids, render_cluster.uniforms);
+            MeasureBatches(headers, render_cluster, image.clusters[render_cluster.cluster_index]);
+        });
+    }
+
+    static void MeasureBatches(const Array<Resource, ResourceMaxCount>& headers, const RenderCluster& render_cluster, Cluster& cluster) { // Batch boxes come from their meshes when those have positions.
+        render_cluster.meshes.ConstProcessIndex([&](auto& mesh_handle, unsigned index) {
+            if ((mesh_handle == InvalidDataHandle) || (index >= cluster.Batches().UsedCount()))
+                return;
+            const auto& mesh = *(const Mesh*)headers[mesh_handle].alloc.Pointer();
+            if (mesh.Extents() == Vector3())
+                return;
+            cluster.Batches()[index].SetExtents(mesh.Extents());
+            cluster.Invalidate(cluster.Batches()[index]);
+        });
+        if (cluster.IsDirty())
+            cluster.ComputeBounds();
+    }
+
+    void LinkFollows(const Array<Resource, ResourceMaxCount>& headers, Cell::Image& image) {
+        auto* records = image.follow_records.Values();
+        unsigned count = 0;
+        image.follow_records.ConstProcess([&](auto& record) { // Keep records whose follow and target resolve, targets must be follow clusters.
+            const auto handle = FindHandle(headers, record.follow_id);
+            if (handle == InvalidDataHandle)
+                return;
+            const auto& follow = *(const Follow*)headers[handle].alloc.Pointer();
+            image.follow_clusters.ConstProcess([&](auto& follow_cluster) {
+                unsigned batch_index = 0;
+                if ((follow_cluster.cluster_id == follow.FollowedClusterId()) && image.clusters[follow_cluster.cluster_index].ConstFindIndex(follow.FollowedBatchId(), batch_index)) {
+                    auto& out = records[count++];
+                    out = record;
+                    out.follow = handle;
+                    out.followed_cluster_index = follow_cluster.cluster_index;
+                    out.followed_batch_index = batch_index;
+                }
+            });
+        });
+        image.follow_records.Set(records, count);
+        SortFollows(records, count, image.clusters.Count() * Cluster::BatchMaxCount);
+    }
+
+    static void SortFollows(FollowRecord* records, unsigned count, unsigned batch_count) { // Kahn's algorithm, a batch is written by at most one record.
+        static const uint32 NoRecord = (uint32)-1;
+        const auto batch_key = [](uint32 cluster_index, uint32 batch_index) { return cluster_index * Cluster::BatchMaxCount + batch_index; };
+        Alloc writers_alloc(Math::Max(batch_count, 1u) * sizeof(uint32));
+        Alloc readers_alloc(Math::Max(batch_count, 1u) * sizeof(uint32));
+        Alloc next_alloc(Math::Max(count, 1u) * sizeof(uint32));
+        Alloc queue_alloc(Math::Max(count, 1u) * sizeof(uint32));
+        Alloc sorted_alloc(Math::Max(count, 1u) * sizeof(FollowRecord));
+        auto* writers = (uint32*)writers_alloc.Pointer(); // Batch key to the record writing it.
+        auto* readers = (uint32*)readers_alloc.Pointer(); // Batch key to the first record following it, chained through next.
+        auto* next = (uint32*)next_alloc.Pointer();
+        auto* queue = (uint32*)queue_alloc.Pointer();
+        auto* sorted = (FollowRecord*)sorted_alloc.Pointer();
+        memset(writers, 0xFF, batch_count * sizeof(uint32));
+        memset(readers, 0xFF, batch_count * sizeof(uint32));
+        for (unsigned i = 0; i < count; ++i) {
+            auto& writer = writers[batch_key(records[i].cluster_index, records[i].batch_index)];
+            if (writer != NoRecord)
+                throw Exception("Batch cannot have more than 1 follow");
+            writer = i;
+            auto& reader = readers[batch_key(records[i].followed_cluster_index, records[i].followed_batch_index)];
+            next[i] = reader;
+            reader = i;
+        }
+        unsigned tail = 0;
+        for (unsigned i = 0; i < count; ++i) { // Records following a batch nobody writes are ready first.
+            if (writers[batch_key(records[i].followed_cluster_index, records[i].followed_batch_index)] == NoRecord) {
+                records[i].level = 0;
+                queue[tail++] = i;
+            }
+        }
+        for (unsigned head = 0; head < tail; ++head) { // Breadth first, so the queue is in level order.
+            const auto& writer = records[queue[head]];
+            for (uint32 i = readers[batch_key(writer.cluster_index, writer.batch_index)]; i != NoRecord; i = next[i]) {
+                records[i].level = writer.level + 1;
+                queue[tail++] = i;
+            }
+        }
+        if (tail < count)
+            throw Exception("Follow cycle detected");
+        for (unsigned i = 0; i < count; ++i)
+            sorted[i] = records[queue[i]];
+        memcpy(records, sorted, count * sizeof(FollowRecord));
+    }
+
+    void LinkCamera(const Array<Resource, ResourceMaxCount>& headers, Camera& camera, const Array<Camera::TargetLinks, Camera::TargetMaxCount>& target_links) {
+        camera.Targets().ProcessIndex([&](auto& target, unsigned target_index) {
+            const auto& links = target_links[target_index];
+            target.passes.ProcessIndex([&](auto& pass, unsigned pass_index) {
+                const auto& pass_links = links.passes[pass_index];
+                pass.auto_shader = FindHandle(headers, pass_links.auto_shader_id);
+                pass.auto_mesh = FindHandle(headers, pass_links.auto_mesh_id);
+                pass.auto_uniforms = FindHandle(headers, pass_links.auto_uniforms_id);
+                LinkHandles(headers, pass_links.auto_surface_ids, pass.auto_surfaces);
+            });
+            LinkHandles(headers, links.color_attachment_ids, target.color_attachments);
+            target.depth_stencil_attachment = FindHandle(headers, links.depth_stencil_attachment_id);
+        });
+    }
+
+    void Link(Array<Resource, ResourceMaxCount>& headers, Array<Resource, ResourceMaxCount>& datas) {
+        if (headers.UsedCount() >= InvalidDataHandle)
+            throw Exception("Too many resources for data handles");
+        headers.Process([&](auto& header) {
+            switch (Data::DataTypeFromId(header.data_id)) {
+            case Data::Type::Camera: {
+                datas.Process([&](auto& data) {
+                    if (data.data_id == header.data_id)
+                        LinkCamera(headers, *(Camera*)header.alloc.Pointer(), *(const Array<Camera::TargetLinks, Camera::TargetMaxCount>*)data.alloc.Pointer());
+                });
+                break;
+            }
+            case Data::Type::Cell: {
+                datas.Process([&](auto& data) {
+                    if (data.data_id == header.data_id) {
+                        LinkCell(headers, *(Cell::Image*)data.alloc.Pointer());
+                        LinkFollows(headers, *(Cell::Image*)data.alloc.Pointer());
+                    }
+                });
+                break;
+            }
+            default: break;
+            }
+        });
     }
 
     static size SizeResources(const Array<Resource, ResourceMaxCount>& resources) {
         size size = 0;
         resources.ConstProcess([&](auto& resource) {
-            size += resource.alloc.Size() + Data::DynamicSize;
+            size += Arena::AlignSize(resource.alloc.Size());
         });
         return size;
     }
@@ -1113,12 +1565,27 @@ class Packager : public NoCopy {
         return out;
     }
 
+    uint8* WriteRanges(uint8* out, const Array<Resource, ResourceMaxCount>& resources) {
+        auto* ranges = (Bundle::Range*)out;
+        resources.ConstProcessIndex([&](auto& resource, unsigned index) {
+            const auto data_type = Data::DataTypeFromId(resource.data_id);
+            if (data_type >= Data::Type::Count) throw Exception("Invalid data type");
+            auto& range = ranges[(unsigned)data_type];
+            if (range.begin == range.end)
+                range = Bundle::Range(index, index + 1);
+            else
+                range.end = index + 1;
+        });
+        out += (unsigned)Data::Type::Count * sizeof(Bundle::Range);
+        return out;
+    }
+
     uint8* WriteTable(uint8* out, const Array<Resource, ResourceMaxCount>& resources, size start) {
         size offset = start;
         resources.ConstProcessIndex([&](auto& resource, unsigned index) {
             const size size = resource.alloc.Size();
             ((Bundle::Resource*)out)[index] = Bundle::Resource(resource.data_id, offset, size);
-            offset += size + Data::DynamicSize;
+            offset += Arena::AlignSize(size);
         });
         out += resources.UsedCount() * sizeof(Bundle::Resource);
         return out;
@@ -1128,30 +1595,36 @@ class Packager : public NoCopy {
         resources.ConstProcess([&](auto& resource) {
             const size size = resource.alloc.Size();
             memcpy(out, resource.alloc.Pointer(), size);
-            out += size;
-            memset(out, 0, Data::DynamicSize);
-            out += Data::DynamicSize;
+            out += Arena::AlignSize(size);
         });
         return out;
     }
 
-    void Write(const Array<Resource, ResourceMaxCount>& headers, const Array<Resource, ResourceMaxCount>& datas) {
+    void Write(const Array<Resource, ResourceMaxCount>& headers, const Array<Resource, ResourceMaxCount>& datas, const NameTable& names) {
         const unsigned header_count = headers.UsedCount();
         const unsigned data_count = datas.UsedCount();
+        const unsigned name_count = names.Count();
         const size headers_size = SizeResources(headers);
         const size datas_size = SizeResources(datas);
+        const size names_size = names.StringsSize();
         const size resources_size = header_count * sizeof(Bundle::Resource);
         const size entries_size = data_count * sizeof(Bundle::Resource);
-        const size metadata_size = sizeof(uint32) * 2 + resources_size + entries_size;
-        const size total_size = metadata_size + headers_size + datas_size;
+        const size name_entries_size = name_count * sizeof(Bundle::Resource);
+        const size ranges_size = (unsigned)Data::Type::Count * sizeof(Bundle::Range);
+        const size metadata_size = Arena::AlignSize(sizeof(uint32) * 3 + ranges_size + resources_size + entries_size + name_entries_size); // Keep resources aligned in the mapping.
+        const size total_size = metadata_size + headers_size + datas_size + names_size;
         WriteOnlyFile bundle_file(Bundle::Name(), total_size);
         auto* out = (uint8*)bundle_file.Pointer();
         out = WriteCount(out, header_count);
         out = WriteCount(out, data_count);
+        out = WriteCount(out, name_count);
+        out = WriteRanges(out, headers);
         out = WriteTable(out, headers, metadata_size);
         out = WriteTable(out, datas, metadata_size + headers_size);
-        out = WriteResources(out, headers);
+        names.WriteTable(out, metadata_size + headers_size + datas_size);
+        out = WriteResources((uint8*)bundle_file.Pointer() + metadata_size, headers);
         out = WriteResources(out, datas);
+        out = names.WriteStrings(out);
     }
 
 public:
@@ -1161,8 +1634,10 @@ public:
         const auto start = timer.Now();
         Array<Resource, ResourceMaxCount> headers;
         Array<Resource, ResourceMaxCount> datas;
-        Gather(headers, datas);
-        Write(headers, datas);
+        NameTable names(CountNames());
+        Gather(headers, datas, names);
+        Link(headers, datas);
+        Write(headers, datas, names);
         const auto duration = (timer.Now() - start) * 0.000001;
         Log::Put("Package in %llf seconds\n", duration);
     }
@@ -16,5 +16,5 @@ Memory::Alloc ShaderBuild::Compile(const char* source, size source_size, const S
     return bytecode;
 }
 
-void SurfaceBuild::Convert(bool mips) {
+void SurfaceBuild::Convert(const String& name, bool mips) {
 }
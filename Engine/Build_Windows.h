@@ -72,9 +72,9 @@ Alloc ShaderBuild::Compile(const char* source, size source_size, const String& f
     return bytecode;
 }
 
-void SurfaceBuild::Convert(bool mips) {
-    const auto tga_filename = AssetPath() + Name() + ".tga";
-    const auto dds_filename = AssetPath() + Name() + ".dds";
+void SurfaceBuild::Convert(const String& name, bool mips) {
+    const auto tga_filename = AssetPath() + name + ".tga";
+    const auto dds_filename = AssetPath() + name + ".dds";
 
     LongString exe = "Tools\\Crunch\\bin\\crunch_x64.exe";
     LongString in = LongString(" -file ") + tga_filename.Data();
@@ -112,7 +112,7 @@ void SurfaceBuild::Convert(bool mips) {
         dimension = dds.dimension;
 
         const size data_size = file_size - offset;
-        WriteOnlyFile data_file(CacheDataFilename(Name()), data_size);
+        WriteOnlyFile data_file(CacheDataFilename(name), data_size);
         memcpy((uint8*)data_file.Pointer(), data + offset, data_size);
     }
 
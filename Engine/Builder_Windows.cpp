@@ -11,9 +11,12 @@
 #include <D3Dcompiler.h>
 #include <math.h> // sinf, cosf
 #include <Windows.h>
+#include <Psapi.h> // QueryWorkingSetEx
 #include <wrl.h>
+#include <xmmintrin.h> // _mm_xxx
 
 #pragma comment(lib, "d3dcompiler.lib")
+#pragma comment(lib, "Psapi.lib")
 
 #if defined(DEBUG)
 #define DEBUG_ONLY(A) A
@@ -7,9 +7,8 @@ class ScriptDynamic : public Script {
     UpdateFunc update_func = nullptr;
 
     String Create(const Bundle& bundle) {
-        auto normalized_name = Name();
-        normalized_name.Replace('/', '_');
-        const auto dll_filename = normalized_name + ".dll";
+        char dll_filename[32];
+        if (snprintf(dll_filename, sizeof(dll_filename), "script_%016llx.dll", Id()) < 0) throw Exception();
         const auto asset = bundle.FindData(Id());
         WriteOnlyFile dll_file(dll_filename, asset.Size());
         memcpy(dll_file.Pointer(), asset.Mem(), asset.Size());
@@ -17,8 +16,8 @@ class ScriptDynamic : public Script {
     }
 
 public:
-    ScriptDynamic(uint64 id, const String& name)
-        : Script(id, name) {}
+    ScriptDynamic(uint64 id)
+        : Script(id) {}
 
     void Load(const Bundle& bundle) {
         const auto data_filename = Create(bundle);
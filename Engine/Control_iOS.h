@@ -13,7 +13,7 @@ class ScriptDynamic : public Script {
     
 public:
     void Load(Bundle& bundle, Commands& commands) {
-        if (Name() == "Scripts/Game.script") { type = Game; }
+        if (Id() == Data::IdFromName("Scripts/Game.script")) { type = Game; }
         switch (type) {
             case Game: Game_Init(commands); break;
             default: break;
@@ -21,7 +21,6 @@ public:
     }
     
     void Mouse(MousePhase phase, Button button, float u, float v, float w) {
-        if (Name() == "Game.script") { type = Game; }
         switch (type) {
             case Game: Game_Mouse(phase, button, u, v, w); break;
             default: break;
@@ -29,7 +28,6 @@ public:
     }
     
     void Keyboard(KeyboardPhase phase, Key key) {
-        if (Name() == "Game.script") { type = Game; }
         switch (type) {
             case Game: Game_Keyboard(phase, key); break;
             default: break;
@@ -37,7 +35,6 @@ public:
     }
     
     void Execute(float elapsed_time, unsigned window_witdh, unsigned window_height) {
-        if (Name() == "Game.script") { type = Game; }
         switch (type) {
             case Game: Game_Update(elapsed_time, window_witdh, window_height); break;
             default: break;
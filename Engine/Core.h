@@ -52,6 +52,8 @@ public:
         return *new(&values[used_count++]) T(args...);
     }
 
+    void Clear() { used_count = 0; }
+
     template<typename F> void Process(F func) {
         for (unsigned i = 0; i < used_count; ++i) {
             func(values[i]);
@@ -163,6 +165,163 @@ public:
     }
 };
 
+template<typename K, size SIZE, typename S = uint8> class HashIndex { // Open-addressed positions in the owning array, keys are compared through it.
+    static const unsigned SlotCount = Math::NextPowerOf2(2 * SIZE); // Keep load under half so probes stay short.
+    static const S EmptySlot = (S)-1;
+    static_assert(SIZE < EmptySlot);
+
+    S slots[SlotCount];
+
+    static unsigned Home(const K& key) { return Hash::Key(key) & (SlotCount - 1); }
+
+    template<typename F> unsigned FindSlot(const K& key, F key_at) const {
+        for (unsigned i = 0; i < SlotCount; ++i) {
+            const unsigned slot = (Home(key) + i) & (SlotCount - 1);
+            if (slots[slot] == EmptySlot)
+                break;
+            if (key_at(slots[slot]) == key)
+                return slot;
+        }
+        return (unsigned)-1;
+    }
+
+public:
+    HashIndex() { Clear(); }
+
+    void Clear() { memset(slots, 0xFF, sizeof(slots)); }
+
+    void Add(const K& key, unsigned index) {
+        for (unsigned i = 0; i < SlotCount; ++i) {
+            auto& slot = slots[(Home(key) + i) & (SlotCount - 1)];
+            if (slot == EmptySlot) {
+                slot = (S)index;
+                return;
+            }
+        }
+        DEBUG_ONLY(throw Exception("Hash index is full");)
+    }
+
+    template<typename F> unsigned Find(const K& key, F key_at) const {
+        const unsigned slot = FindSlot(key, key_at);
+        return slot != (unsigned)-1 ? slots[slot] : (unsigned)-1;
+    }
+
+    template<typename F> void Move(const K& key, unsigned index, F key_at) { // The key now lives at index in the owning array.
+        const unsigned slot = FindSlot(key, key_at);
+        if (slot != (unsigned)-1)
+            slots[slot] = (S)index;
+    }
+
+    template<typename F> void Remove(const K& key, F key_at) { // Shifts the rest of the probe chain back instead of leaving a tombstone.
+        unsigned hole = FindSlot(key, key_at);
+        if (hole == (unsigned)-1)
+            return;
+        for (unsigned slot = (hole + 1) & (SlotCount - 1); slots[slot] != EmptySlot; slot = (slot + 1) & (SlotCount - 1)) {
+            if (((slot - Home(key_at(slots[slot]))) & (SlotCount - 1)) >= ((slot - hole) & (SlotCount - 1))) {
+                slots[hole] = slots[slot];
+                hole = slot;
+            }
+        }
+        slots[hole] = EmptySlot;
+    }
+};
+
+template<typename T, size SIZE> class SlotMap : public NoCopy { // Dense values addressed by generational handles.
+    static_assert(SIZE <= 0xFFFF);
+
+    struct Slot {
+        uint16 dense_index = 0; // Next free slot when unused.
+        uint16 generation = 0;
+    };
+
+    T values[SIZE];
+    uint16 dense_slots[SIZE];
+    Slot slots[SIZE];
+    unsigned used_count = 0;
+    unsigned slot_count = 0;
+    unsigned free_head = (unsigned)-1;
+
+    static uint32 MakeHandle(unsigned slot_index, uint16 generation) { return ((uint32)generation << 16) | slot_index; }
+    static uint16 Generation(uint32 handle) { return (uint16)(handle >> 16); }
+
+    const Slot* FindSlot(uint32 handle) const {
+        const unsigned slot_index = SlotIndex(handle);
+        if ((slot_index >= slot_count) || (slots[slot_index].generation != Generation(handle)))
+            return nullptr;
+        if ((slots[slot_index].dense_index >= used_count) || (dense_slots[slots[slot_index].dense_index] != slot_index))
+            return nullptr; // Free slot.
+        return &slots[slot_index];
+    }
+
+public:
+    static const uint32 GenerationMask = 0x7FFF; // Leaves the top handle bit free for callers.
+    static const uint32 InvalidHandle = (uint32)-1;
+
+    static unsigned SlotIndex(uint32 handle) { return handle & 0xFFFF; } // Stable while the handle lives.
+
+    uint32 Add(const T& value) {
+        if (used_count >= SIZE)
+            return InvalidHandle;
+        unsigned slot_index = slot_count;
+        if (free_head != (unsigned)-1) {
+            slot_index = free_head;
+            free_head = slots[slot_index].dense_index != slot_index ? slots[slot_index].dense_index : (unsigned)-1;
+        } else {
+            slot_count++;
+        }
+        slots[slot_index].dense_index = (uint16)used_count;
+        dense_slots[used_count] = (uint16)slot_index;
+        values[used_count++] = value;
+        return MakeHandle(slot_index, slots[slot_index].generation);
+    }
+
+    bool Remove(uint32 handle) {
+        const auto* slot = FindSlot(handle);
+        if (!slot)
+            return false;
+        const unsigned slot_index = SlotIndex(handle);
+        const unsigned dense_index = slot->dense_index;
+        const unsigned last_index = --used_count;
+        values[dense_index] = values[last_index];
+        dense_slots[dense_index] = dense_slots[last_index];
+        slots[dense_slots[dense_index]].dense_index = (uint16)dense_index;
+        slots[slot_index].generation = (uint16)((slots[slot_index].generation + 1) & GenerationMask);
+        slots[slot_index].dense_index = (uint16)(free_head != (unsigned)-1 ? free_head : slot_index);
+        free_head = slot_index;
+        return true;
+    }
+
+    T* Find(uint32 handle) {
+        const auto* slot = FindSlot(handle);
+        return slot ? &values[slot->dense_index] : nullptr;
+    }
+
+    const T* ConstFind(uint32 handle) const {
+        const auto* slot = FindSlot(handle);
+        return slot ? &values[slot->dense_index] : nullptr;
+    }
+
+    uint32 Handle(unsigned dense_index) const {
+        const unsigned slot_index = dense_slots[dense_index];
+        return MakeHandle(slot_index, slots[slot_index].generation);
+    }
+
+    template<typename F> void Process(F func) {
+        for (unsigned i = 0; i < used_count; ++i) {
+            func(values[i]);
+        }
+    }
+
+    template<typename F> void ConstProcessIndex(F func) const {
+        for (unsigned i = 0; i < used_count; ++i) {
+            func(values[i], i);
+        }
+    }
+
+    const T* Values() const { return values; }
+    unsigned UsedCount() const { return used_count; }
+};
+
 template<typename T> class ProxyArray : public NoCopy {
     unsigned count = 0;
     T* values = nullptr;
@@ -240,6 +399,55 @@ public:
     }
 };
 
+template<typename T> class RelPtr { // Offset from this, so images can be mapped or copied without fixup.
+    int32 offset = 0;
+
+public:
+    void Set(const T* target) { offset = target ? (int32)((const uint8*)target - (const uint8*)this) : 0; }
+
+    T* Get() { return offset ? (T*)((uint8*)this + offset) : nullptr; }
+    const T* Get() const { return offset ? (const T*)((const uint8*)this + offset) : nullptr; }
+
+    operator bool() const { return offset != 0; }
+};
+
+template<typename T> class RelArray {
+    RelPtr<T> values;
+    uint32 count = 0;
+
+public:
+    void Set(const T* values, unsigned count) {
+        this->values.Set(values);
+        this->count = count;
+    }
+
+    template<typename F> void ConstProcess(F func) const {
+        for (unsigned i = 0; i < count; ++i) {
+            func(Values()[i]);
+        }
+    }
+
+    template<typename F> void ConstProcessIndex(F func) const {
+        for (unsigned i = 0; i < count; ++i) {
+            func(Values()[i], i);
+        }
+    }
+
+    T* Values() { return values.Get(); }
+    const T* Values() const { return values.Get(); }
+    unsigned Count() const { return count; }
+
+    const T& operator[](size i) const {
+        DEBUG_ONLY(if (i >= count) throw Exception("Out-of-bounds");)
+        return Values()[i];
+    }
+
+    T& operator[](size i) {
+        DEBUG_ONLY(if (i >= count) throw Exception("Out-of-bounds");)
+        return Values()[i];
+    }
+};
+
 template<typename T> class BitFlags {
     T flags;
 
@@ -412,6 +620,137 @@ namespace Log {
     }
 }
 
+namespace Memory {
+    enum class Tag : uint8 {
+        None = 0,
+        Build,
+        Profile,
+        Stack,
+        Mesh,
+        Surface,
+        Bundle,
+        Draw,
+        Spawn,
+        Hierarchy,
+        Tree,
+        Overlap,
+        Occlusion,
+        Count
+    };
+
+    struct Counter {
+        volatile int64 current = 0;
+        volatile int64 peak = 0;
+        volatile int64 count = 0;
+    };
+
+    struct Owner {
+        volatile int64 id = 0;
+        volatile int64 current = 0;
+    };
+
+    static const unsigned OwnerMaxCount = 1024;
+
+    Counter counters[(unsigned)Tag::Count];
+    Owner owners[OwnerMaxCount];
+
+    static const char* TagName(Tag tag) {
+        switch (tag) {
+        case Tag::None: return "none";
+        case Tag::Build: return "build";
+        case Tag::Profile: return "profile";
+        case Tag::Stack: return "stack";
+        case Tag::Mesh: return "mesh";
+        case Tag::Surface: return "surface";
+        case Tag::Bundle: return "bundle";
+        case Tag::Draw: return "draw";
+        case Tag::Spawn: return "spawn";
+        case Tag::Hierarchy: return "hierarchy";
+        case Tag::Tree: return "tree";
+        case Tag::Overlap: return "overlap";
+        case Tag::Occlusion: return "occlusion";
+        default: return "unknown";
+        }
+    }
+
+    // Open addressing, slots are claimed once and never released.
+    void TrackOwner(uint64 owner, int64 delta) {
+        if (owner == 0)
+            return;
+        const unsigned start = Hash::Key(owner) % OwnerMaxCount;
+        for (unsigned i = 0; i < OwnerMaxCount; ++i) {
+            auto& slot = owners[(start + i) % OwnerMaxCount];
+            if ((slot.id == (int64)owner) || Atomic::CompareExchange(slot.id, (int64)owner, 0) || (slot.id == (int64)owner)) {
+                Atomic::Add(slot.current, delta);
+                return;
+            }
+        }
+    }
+
+    void Track(Tag tag, uint64 owner, int64 delta) {
+        auto& counter = counters[(unsigned)tag];
+        const int64 current = Atomic::Add(counter.current, delta);
+        Atomic::Add(counter.count, delta > 0 ? 1 : -1);
+        int64 peak = counter.peak;
+        while ((current > peak) && !Atomic::CompareExchange(counter.peak, current, peak))
+            peak = counter.peak;
+        TrackOwner(owner, delta);
+    }
+
+    void* Allocate(size size, Tag tag, uint64 owner = 0) {
+        Track(tag, owner, (int64)size);
+        return Malloc(size);
+    }
+
+    void Deallocate(void* mem, size size, Tag tag, uint64 owner = 0) {
+        if (mem) {
+            Track(tag, owner, -(int64)size);
+            Free(mem, size);
+        }
+    }
+
+    template<typename F> void ProcessCounters(F func) {
+        for (unsigned i = 0; i < (unsigned)Tag::Count; ++i)
+            func((Tag)i, counters[i]);
+    }
+
+    template<typename F> void ProcessOwners(F func) {
+        for (unsigned i = 0; i < OwnerMaxCount; ++i)
+            if (owners[i].id != 0)
+                func((uint64)owners[i].id, owners[i].current);
+    }
+};
+
+class Arena : public NoCopy {
+    uint8* mem = nullptr;
+    size capacity = 0;
+    size used = 0;
+    Memory::Tag tag = Memory::Tag::None;
+    uint64 owner = 0;
+
+public:
+    static const size Alignment = 16;
+
+    Arena() {}
+    Arena(size capacity, Memory::Tag tag, uint64 owner = 0)
+        : mem((uint8*)Memory::Allocate(capacity, tag, owner)), capacity(capacity), tag(tag), owner(owner) {
+        memset(mem, 0, capacity);
+    }
+    ~Arena() { Memory::Deallocate(mem, capacity, tag, owner); }
+
+    static constexpr size AlignSize(size size) { return Math::AlignSize(size, Alignment); }
+
+    uint8* Allocate(size size) {
+        const auto aligned_size = AlignSize(size);
+        DEBUG_ONLY(if (used + aligned_size > capacity) throw Exception("Arena is full");)
+        uint8* result = mem + used;
+        used += aligned_size;
+        return result;
+    }
+
+    size Used() const { return used; }
+};
+
 class File : public NoCopy {
     String filename;
     Descriptor descriptor;
@@ -433,6 +772,7 @@ public:
 
     const String& FileName() const { return filename; }
     size Size() const { return descriptor.Size(); }
+    size ResidentSize() const { return descriptor.ResidentSize(); }
     void* Pointer() const { return descriptor.Pointer(); }
 
     bool IsNewer(const File& file) {
@@ -534,18 +874,53 @@ enum class Color : unsigned {
     Orange = Math::RGBA(255, 128, 0, 255),
 };
 
+struct Zone {
+    constexpr Zone(const char* name, const char* file, unsigned line, Color color)
+        : name(name), file(file), line(line), color(color) {}
+
+    const char* name;
+    const char* file;
+    unsigned line;
+    Color color;
+};
+
+struct ZoneStats {
+    ZoneStats() {}
+    ZoneStats(const Zone* zone)
+        : zone(zone) {}
+
+    void Add(uint64 duration) {
+        count++;
+        total += duration;
+        min = Math::Min(min, duration);
+        max = Math::Max(max, duration);
+    }
+
+    uint64 Average() const { return count > 0 ? total / count : 0; }
+
+    const Zone* zone = nullptr;
+    uint64 count = 0;
+    uint64 total = 0;
+    uint64 min = (uint64)-1;
+    uint64 max = 0;
+};
+
 struct Capture {
     Capture() {}
-    Capture(uint64 begin_time, Color color)
-        : begin_time(begin_time), color(color) {}
+    Capture(uint64 begin_time, Color color, unsigned depth)
+        : begin_time(begin_time), color(color), depth(depth) {}
     Capture(uint64 begin_time, uint64 end_time, Color color)
         : begin_time(begin_time), end_time(end_time), color(color) {}
+    Capture(uint64 begin_time, uint64 end_time, Color color, unsigned depth, const char* name)
+        : begin_time(begin_time), end_time(end_time), color(color), depth(depth), name(name) {}
 
     void End(uint64 time) { end_time = time; }
 
     uint64 begin_time = 0;
     uint64 end_time = 0;
     Color color;
+    unsigned depth = 0;
+    const char* name = nullptr;
 };
 
 class Track : public NoCopy {
@@ -558,21 +933,26 @@ class Track : public NoCopy {
     static unsigned Next(unsigned i) { return (i + 1) % CaptureMaxCount; }
 
 public:
+    static const unsigned InvalidIndex = (unsigned)-1;
+
     void Clear() {
         start = 0;
         end = 0;
     }
 
-    void Begin(uint64 time, Color color) {
+    unsigned Begin(uint64 time, Color color, unsigned depth) {
         if (Next(end) != start) {
-            captures[end] = Capture(time, color);
+            const unsigned index = end;
+            captures[end] = Capture(time, color, depth);
+            end = Next(end);
+            return index;
         }
+        return InvalidIndex;
     }
 
-    void End(uint64 time) {
-        if (Next(end) != start) {
-            captures[end].End(time);
-            end = Next(end);
+    void End(unsigned index, uint64 time) {
+        if (index != InvalidIndex) {
+            captures[index].End(time);
         }
     }
 
@@ -586,25 +966,243 @@ public:
     template<typename F> void Process(F func) {
         bool stop = false;
         while ((end != start) && !stop) {
-            if (Next(end) != start) {
-                if (func(captures[start], stop)) {
-                    start = Next(start);
-                }
+            if (func(captures[start], stop)) {
+                start = Next(start);
             }
         }
     }
 };
 
+struct FrameCaptures {
+    static const unsigned CPUMaxCount = 128;
+    static const unsigned GPUMaxCount = 32;
+
+    void Reset(uint64 index, uint64 begin_time) {
+        this->index = index;
+        this->begin_time = begin_time;
+        end_time = begin_time;
+        gpu_duration = 0;
+        cpu.Clear();
+        gpu.Clear();
+    }
+
+    uint64 index = 0;
+    uint64 begin_time = 0;
+    uint64 end_time = 0;
+    uint64 gpu_duration = 0;
+    Array<Capture, CPUMaxCount> cpu;
+    Array<Capture, GPUMaxCount> gpu;
+};
+
 class Profile : public NoCopy {
     static const unsigned TrackMaxCount = 2;
+    static const unsigned ZoneMaxCount = 64;
+    static const unsigned FrameMaxCount = 8;
 
     FixedArray<Track, TrackMaxCount> tracks;
+    Array<ZoneStats, ZoneMaxCount> zones;
+    unsigned depth = 0;
+
+    FixedArray<FrameCaptures, FrameMaxCount> frames;
+    unsigned frame_index = 0;
+    uint64 frame_count = 0;
+    uint64 last_hitch_index = 0;
+    uint64 hitch_budget = 33333;
+
+    FrameCaptures& Current() { return frames[frame_index]; }
+
+    static void Append(char* buffer, size max_size, size& used, const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        const int count = vsnprintf(buffer + used, max_size - used, format, args);
+        va_end(args);
+        if (count > 0)
+            used = Math::Min(used + count, max_size - 1);
+    }
 
 public:
-    void BeginCPU(uint64 time, Color color) { tracks[1].Begin(time, color); }
-    void EndCPU(uint64 time) { tracks[1].End(time); }
-    void BeginEndGPU(uint64 begin_time, uint64 end_time, Color color) { tracks[0].BeginEnd(begin_time, end_time, color); }
+    unsigned Register(const Zone& zone) {
+        zones.Add(&zone);
+        return zones.UsedCount() - 1;
+    }
+
+    unsigned BeginZone(unsigned zone_index, uint64 time) {
+        return tracks[1].Begin(time, zones[zone_index].zone->color, depth++);
+    }
+
+    void EndZone(unsigned zone_index, unsigned capture_index, uint64 begin_time, uint64 end_time) {
+        depth--;
+        tracks[1].End(capture_index, end_time);
+        zones[zone_index].Add(end_time - begin_time);
+        const auto* zone = zones[zone_index].zone;
+        if (!Current().cpu.IsFull())
+            Current().cpu.Add(begin_time, end_time, zone->color, depth, zone->name);
+    }
+
+    void BeginEndGPU(uint64 begin_time, uint64 end_time, Color color) {
+        tracks[0].BeginEnd(begin_time, end_time, color);
+        if (!Current().gpu.IsFull())
+            Current().gpu.Add(begin_time, end_time, color, 0u, "GPU");
+    }
+
+    void SetHitchBudget(uint64 budget) { hitch_budget = budget; }
+
+    void BeginFrame(uint64 time) {
+        frame_index = (frame_index + 1) % FrameMaxCount;
+        Current().Reset(++frame_count, time);
+    }
+
+    // Returns true when the CPU or GPU frame went over budget and the history has not been written since.
+    bool EndFrame(uint64 time, uint64 gpu_duration) {
+        Current().end_time = time;
+        Current().gpu_duration = gpu_duration;
+        const uint64 duration = Math::Max(time - Current().begin_time, gpu_duration);
+        if ((hitch_budget > 0) && (duration > hitch_budget) && (frame_count >= last_hitch_index + FrameMaxCount)) {
+            last_hitch_index = frame_count;
+            return true;
+        }
+        return false;
+    }
+
+    uint64 FrameCount() const { return frame_count; }
+
+    // Chrome trace event format, oldest frame first.
+    void WriteTrace(const String& filename) const {
+        const size max_size = FrameMaxCount * (FrameCaptures::CPUMaxCount + FrameCaptures::GPUMaxCount + 1) * 160;
+        char* buffer = (char*)Memory::Allocate(max_size, Memory::Tag::Profile);
+        size used = 0;
+        Append(buffer, max_size, used, "{\"traceEvents\":[\n");
+        bool first = true;
+        for (unsigned i = 1; i <= FrameMaxCount; ++i) {
+            const auto& frame = frames[(frame_index + i) % FrameMaxCount];
+            if (frame.index == 0)
+                continue;
+            Append(buffer, max_size, used, "%s{\"name\":\"Frame\",\"ph\":\"C\",\"pid\":0,\"ts\":%llu,\"args\":{\"index\":%llu,\"cpu\":%llu,\"gpu\":%llu}}",
+                first ? "" : ",\n", frame.begin_time, frame.index, frame.end_time - frame.begin_time, frame.gpu_duration);
+            first = false;
+            frame.cpu.ConstProcess([&](const auto& capture) {
+                Append(buffer, max_size, used, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":%llu,\"dur\":%llu,\"args\":{\"frame\":%llu,\"depth\":%u}}",
+                    capture.name, capture.begin_time, capture.end_time - capture.begin_time, frame.index, capture.depth);
+            });
+            frame.gpu.ConstProcess([&](const auto& capture) {
+                Append(buffer, max_size, used, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%llu,\"dur\":%llu,\"args\":{\"frame\":%llu}}",
+                    capture.name, capture.begin_time, capture.end_time - capture.begin_time, frame.index);
+            });
+        }
+        Append(buffer, max_size, used, "\n]}\n");
+        WriteOnlyFile file(filename, used);
+        memcpy(file.Pointer(), buffer, used);
+        Memory::Deallocate(buffer, max_size, Memory::Tag::Profile);
+    }
 
     FixedArray<Track, TrackMaxCount>& Tracks() { return tracks; }
+
+    static const String ZonesName() { return "zones.txt"; }
+
+    void WriteZones(const String& filename) const {
+        const size max_size = ZoneMaxCount * 256;
+        char* buffer = (char*)Memory::Allocate(max_size, Memory::Tag::Profile);
+        size used = 0;
+        zones.ConstProcess([&](const auto& stats) {
+            Append(buffer, max_size, used, "%s (%s:%u): count=%llu total=%lluus avg=%lluus min=%lluus max=%lluus\n", stats.zone->name, stats.zone->file, stats.zone->line,
+                stats.count, stats.total, stats.Average(), stats.count > 0 ? stats.min : 0, stats.max);
+        });
+        WriteOnlyFile file(filename, used);
+        memcpy(file.Pointer(), buffer, used);
+        Memory::Deallocate(buffer, max_size, Memory::Tag::Profile);
+    }
+};
+
+class ScopedZone : public NoCopy {
+    Profile& profile;
+    Timer& timer;
+    unsigned zone_index;
+    unsigned capture_index;
+    uint64 begin_time;
+
+public:
+    ScopedZone(Profile& profile, Timer& timer, unsigned zone_index)
+        : profile(profile), timer(timer), zone_index(zone_index) {
+        begin_time = timer.Now();
+        capture_index = profile.BeginZone(zone_index, begin_time);
+    }
+
+    ~ScopedZone() {
+        profile.EndZone(zone_index, capture_index, begin_time, timer.Now());
+    }
 };
 
+// Log-linear buckets over a rolling window of samples (HDR histogram style, ~3% precision).
+class Histogram : public NoCopy {
+    static const unsigned SubBucketBits = 5;
+    static const unsigned SubBucketCount = 1 << SubBucketBits;
+    static const unsigned BucketCount = (32 - SubBucketBits + 1) * SubBucketCount;
+    static const unsigned WindowCount = 1024;
+
+    FixedArray<uint32, BucketCount> buckets;
+    FixedArray<uint32, WindowCount> window;
+    unsigned window_index = 0;
+    unsigned count = 0;
+
+    static unsigned BucketIndex(uint32 value) {
+        if (value < SubBucketCount)
+            return value;
+        const unsigned shift = Math::Log2(value) - SubBucketBits;
+        return (shift + 1) * SubBucketCount + ((value >> shift) - SubBucketCount);
+    }
+
+    static uint64 BucketValue(unsigned index) {
+        if (index < SubBucketCount)
+            return index;
+        const unsigned shift = index / SubBucketCount - 1;
+        const uint64 lowest = (uint64)(SubBucketCount + index % SubBucketCount) << shift;
+        return lowest + ((uint64)1 << shift) - 1;
+    }
+
+public:
+    Histogram() {
+        for (unsigned i = 0; i < BucketCount; ++i)
+            buckets[i] = 0;
+    }
+
+    void Add(uint64 sample) {
+        const uint32 value = (uint32)Math::Min(sample, (uint64)0xFFFFFFFF);
+        if (count == WindowCount)
+            buckets[BucketIndex(window[window_index])]--;
+        else
+            count++;
+        window[window_index] = value;
+        window_index = (window_index + 1) % WindowCount;
+        buckets[BucketIndex(value)]++;
+    }
+
+    uint64 Percentile(float percentile) const {
+        const uint64 goal = (uint64)(count * percentile / 100.f + 0.5f);
+        uint64 total = 0;
+        for (unsigned i = 0; i < BucketCount; ++i) {
+            total += buckets[i];
+            if ((total > 0) && (total >= goal))
+                return BucketValue(i);
+        }
+        return 0;
+    }
+
+    uint64 Max() const {
+        uint32 max = 0;
+        for (unsigned i = 0; i < count; ++i)
+            max = Math::Max(max, window[i]);
+        return max;
+    }
+
+    unsigned Count() const { return count; }
+};
+
+#define PROFILE_CONCAT_INNER(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_INNER(A, B)
+
+// Expects `profile` and `timer` in scope. Compiles to nothing unless PROFILE_ONLY is enabled.
+#define PROFILE_ZONE(name, color) PROFILE_ONLY( \
+    static constexpr Zone PROFILE_CONCAT(zone_, __LINE__)(name, __FILE__, __LINE__, color); \
+    static const unsigned PROFILE_CONCAT(zone_index_, __LINE__) = profile.Register(PROFILE_CONCAT(zone_, __LINE__)); \
+    ScopedZone PROFILE_CONCAT(scoped_zone_, __LINE__)(profile, timer, PROFILE_CONCAT(zone_index_, __LINE__));)
+
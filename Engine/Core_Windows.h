@@ -98,6 +98,11 @@ public:
     static void Sleep(unsigned milliseconds) { ::Sleep(milliseconds); }
 };
 
+namespace Atomic {
+    int64 Add(volatile int64& value, int64 delta) { return InterlockedExchangeAdd64(&value, delta) + delta; }
+    bool CompareExchange(volatile int64& value, int64 exchange, int64 comparand) { return InterlockedCompareExchange64(&value, exchange, comparand) == comparand; }
+};
+
 namespace Memory {
     void* Malloc(size size) {
         void* mem = malloc(size);
@@ -178,6 +183,26 @@ public:
     void* Pointer() const { return range.VirtualAddress; }
     size Size() const { return range.NumberOfBytes; }
 
+    size ResidentSize() const {
+        static const size PageSize = 4096;
+        static const unsigned QueryMaxCount = 256;
+        if (!range.VirtualAddress)
+            return 0;
+        PSAPI_WORKING_SET_EX_INFORMATION infos[QueryMaxCount];
+        const size page_count = (range.NumberOfBytes + PageSize - 1) / PageSize;
+        size resident_count = 0;
+        for (size page = 0; page < page_count; page += QueryMaxCount) {
+            const unsigned count = (unsigned)Math::Min(page_count - page, (size)QueryMaxCount);
+            for (unsigned i = 0; i < count; ++i)
+                infos[i].VirtualAddress = (uint8*)range.VirtualAddress + (page + i) * PageSize;
+            if (QueryWorkingSetEx(GetCurrentProcess(), infos, count * sizeof(PSAPI_WORKING_SET_EX_INFORMATION))) {
+                for (unsigned i = 0; i < count; ++i)
+                    resident_count += infos[i].VirtualAttributes.Valid ? 1 : 0;
+            }
+        }
+        return Math::Min(resident_count * PageSize, (size)range.NumberOfBytes);
+    }
+
     static bool Exist(const char* path) {
         const DWORD dwAttrib = GetFileAttributesA(path);
         return (dwAttrib != INVALID_FILE_ATTRIBUTES && !(dwAttrib & FILE_ATTRIBUTE_DIRECTORY));
@@ -75,6 +75,11 @@ public:
     static void Sleep(unsigned milliseconds) { usleep(milliseconds * 1000); }
 };
 
+namespace Atomic {
+    int64 Add(volatile int64& value, int64 delta) { return OSAtomicAdd64(delta, &value); }
+    bool CompareExchange(volatile int64& value, int64 exchange, int64 comparand) { return OSAtomicCompareAndSwap64(comparand, exchange, &value); }
+};
+
 namespace Memory {
     static const size PageSize = 64 * 1024;
 
@@ -171,6 +176,21 @@ public:
     
     void* Pointer() const { return mem; }
     size Size() const { return mem_size; }
+
+    size ResidentSize() const {
+        if (!mem)
+            return 0;
+        const size page_size = getpagesize();
+        const size page_count = (mem_size + page_size - 1) / page_size;
+        char* pages = (char*)malloc(page_count);
+        size resident_count = 0;
+        if (mincore(mem, mem_size, pages) == 0) {
+            for (size i = 0; i < page_count; ++i)
+                resident_count += (pages[i] & MINCORE_INCORE) ? 1 : 0;
+        }
+        free(pages);
+        return Math::Min(resident_count * page_size, mem_size);
+    }
     
     static bool Exist(const char* path) {
         return access(path, F_OK) != -1;
@@ -1,24 +1,21 @@
 
 class Named : public NoCopy {
-    String name;
     uint64 id = 0;
 
 public:
     Named() {}
     Named(uint64 id) : id(id) {}
-    Named(uint64 id, const String& name) : id(id), name(name) {}
 
     bool operator>(const Named& other) const { return id > other.id; }
     bool operator<(const Named& other) const { return id < other.id; }
     bool operator==(const Named& other) const { return id == other.id; }
 
     uint64 Id() const { return id; }
-    const String& Name() const { return name; }
 };
 
 class Data : public Named {
 public:
-    static const size DynamicSize = 256; // TODO: Remove.
+    static const size DynamicSize = 256; // Room for runtime state appended by *Dynamic types in the bundle arena.
 
     enum class Type : uint16 {
         Cell = 0,
@@ -38,8 +35,8 @@ public:
     };
 
     Data() {}
-    Data(uint64 id, const String& name)
-        : Named(id, name) {}
+    Data(uint64 id)
+        : Named(id) {}
 
     static constexpr Type DataTypeFromId(uint64 id) { return (Type)((uint32)(id >> 32) & (((uint32)1 << 16) - 1)); }
     static constexpr uint64 CreateId(Type data_type, uint32 hash) { return ((uint64)data_type << 32) | (uint64)hash; }
@@ -60,6 +57,28 @@ public:
         else return Type::Invalid;
     }
 
+    static const char* TypeName(Type data_type) {
+        switch (data_type) {
+        case Type::Surface: return "surface";
+        case Type::Cell: return "cell";
+        case Type::Camera: return "camera";
+        case Type::Dictionary: return "dictionary";
+        case Type::Flags: return "flags";
+        case Type::Follow: return "follow";
+        case Type::Mesh: return "mesh";
+        case Type::Script: return "script";
+        case Type::Shader: return "shader";
+        case Type::Bank: return "bank";
+        case Type::Source: return "source";
+        case Type::Uniforms: return "uniforms";
+        default: return "invalid";
+        }
+    }
+
+    static constexpr bool IsDynamic(Type data_type) { // Written at runtime, the other types are read in place from the mapping.
+        return (data_type != Type::Flags) && (data_type != Type::Source);
+    }
+
     static Type DataTypeFromName(const String& name) {
         return DataTypeFromTypeName(name.SubString(name.FindLast('.') + 1));
     }
@@ -71,6 +90,9 @@ public:
     }
 };
 
+typedef uint16 DataHandle; // Dense index into the bundle header table, assigned by the packager.
+static const DataHandle InvalidDataHandle = (DataHandle)-1;
+
 class Instance {
 public:
     Quaternion rotation;
@@ -81,6 +103,51 @@ public:
     Instance(const Quaternion& rotation, const Vector3& position) : rotation(rotation), position(position) {}
 };
 
+static_assert(sizeof(Instance) == 8 * sizeof(float)); // Loaded as two rows of four floats.
+
+class InstanceLanes { // Four instances transposed so that each component fills one register.
+public:
+    QuaternionLanes rotation;
+    Vector3Lanes position;
+    Float4 scale;
+
+    InstanceLanes(const Instance* instances, unsigned count) {
+        Instance padded[4];
+        if (count < 4) {
+            for (unsigned i = 0; i < count; ++i)
+                padded[i] = instances[i];
+            instances = padded;
+        }
+        rotation = QuaternionLanes(Float4::Load(&instances[0].rotation.x), Float4::Load(&instances[1].rotation.x), Float4::Load(&instances[2].rotation.x), Float4::Load(&instances[3].rotation.x));
+        Float4::Transpose(rotation.x, rotation.y, rotation.z, rotation.w);
+        position = Vector3Lanes(Float4::Load(&instances[0].position.x), Float4::Load(&instances[1].position.x), Float4::Load(&instances[2].position.x));
+        scale = Float4::Load(&instances[3].position.x);
+        Float4::Transpose(position.x, position.y, position.z, scale);
+    }
+
+    void Store(Instance* instances, unsigned count) const {
+        Instance padded[4];
+        Instance* out = count < 4 ? padded : instances;
+        QuaternionLanes r = rotation;
+        Float4::Transpose(r.x, r.y, r.z, r.w);
+        r.x.Store(&out[0].rotation.x);
+        r.y.Store(&out[1].rotation.x);
+        r.z.Store(&out[2].rotation.x);
+        r.w.Store(&out[3].rotation.x);
+        Vector3Lanes p = position;
+        Float4 s = scale;
+        Float4::Transpose(p.x, p.y, p.z, s);
+        p.x.Store(&out[0].position.x);
+        p.y.Store(&out[1].position.x);
+        p.z.Store(&out[2].position.x);
+        s.Store(&out[3].position.x);
+        if (count < 4) {
+            for (unsigned i = 0; i < count; ++i)
+                instances[i] = padded[i];
+        }
+    }
+};
+
 class Batch : public Named {
 public:
     static const unsigned InstanceMaxCount = 64;
@@ -88,24 +155,49 @@ public:
 private:
     Array<Instance, InstanceMaxCount> instances;
     Vector3 extents;
+    Vector3 box_min;
+    Vector3 box_max;
     Sphere sphere;
+    bool dirty = true;
 
 public:
     Batch() {}
-    Batch(uint64 id, const String& name, const Vector3& extents)
-        : Named(id, name), extents(extents) {}
+    Batch(uint64 id, const Vector3& extents)
+        : Named(id), extents(extents) {}
 
     Array<Instance, InstanceMaxCount>& Instances() { return instances; }
     const Array<Instance, InstanceMaxCount>& Instances() const { return instances; }
     const Vector3& Extents() const { return extents; }
     const Sphere& Bounds() const { return sphere; }
+    Aabb BoundingBox() const { return Aabb(box_min, box_max); }
+
+    void Invalidate() { dirty = true; }
+    bool IsDirty() const { return dirty; }
+
+    void SetExtents(const Vector3& mesh_extents) { // Replaces the authored box by the one measured on the mesh.
+        extents = mesh_extents;
+        dirty = true;
+    }
+
+    Aabb InstanceBox(const Instance& instance) const {
+        const auto half = Box(extents).Enclose(instance.rotation);
+        return Aabb(instance.position - half, instance.position + half);
+    }
 
     void ComputeBounds(Vector3& min, Vector3& max) {
-        instances.ProcessIndex([&](auto& instance, unsigned index) {
-            min = min.Minimum(instance.position - extents);
-            max = max.Maximum(instance.position + extents);
-        });
-        new(&sphere) Sphere(min - extents, max + extents);
+        if (dirty) {
+            box_min = Vector3(Math::Large);
+            box_max = Vector3(-Math::Large);
+            instances.Process([&](auto& instance) {
+                const auto box = InstanceBox(instance);
+                box_min = box_min.Minimum(box.min);
+                box_max = box_max.Maximum(box.max);
+            });
+            new(&sphere) Sphere(box_min, box_max);
+            dirty = false;
+        }
+        min = min.Minimum(box_min);
+        max = max.Maximum(box_max);
     }
 };
 
@@ -113,101 +205,80 @@ typedef FixedArray<Instance, Batch::InstanceMaxCount> Instances;
 
 class Cluster : public Named {
 public:
-    static const size DynamicSize = 512; // TODO: Remove.
     static const unsigned BatchMaxCount = 16;
 
 private:
     Array<Batch, BatchMaxCount> batches;
+    HashIndex<uint64, BatchMaxCount> batch_index;
+    Aabb box;
     Sphere sphere;
     Quaternion rotation;
     Vector3 position;
+    bool dirty = true;
 
 public:
     Cluster() {}
     Cluster(uint64 id) : Named(id) {}
-    Cluster(uint64 id, String& name, const Vector3& position, const Quaternion& rotation)
-        : Named(id, name), position(position), rotation(rotation) {}
+    Cluster(uint64 id, const Vector3& position, const Quaternion& rotation)
+        : Named(id), position(position), rotation(rotation) {}
 
     Array<Batch, BatchMaxCount>& Batches() { return batches; }
     const Array<Batch, BatchMaxCount>& Batches() const { return batches; }
     const Sphere& Bounds() const { return sphere; }
+    const Aabb& BoundingBox() const { return box; }
     const Quaternion& Rotation() const { return rotation; }
     const Vector3& Position() const { return position; }
 
-    Batch* Find(uint64 id) { // TODO: Remove.
-        Batch* result = nullptr;
-        batches.Process([&](auto& batch) {
-            if (batch.Id() == id)
-                result = &batch;
-        });
-        return result;
+    unsigned FindIndex(uint64 id) const {
+        return batch_index.Find(id, [&](unsigned index) { return batches[index].Id(); });
     }
 
-    const Batch* ConstFind(uint64 id) const { // TODO: Remove.
-        const Batch* result = nullptr;
-        batches.ConstProcess([&](auto& batch) {
-            if (batch.Id() == id)
-                result = &batch;
-        });
-        return result;
+    Batch* Find(uint64 id) {
+        const unsigned index = FindIndex(id);
+        return index != (unsigned)-1 ? &batches[index] : nullptr;
     }
 
-    const Batch* ConstFindIndex(uint64 id, unsigned& out_index) const { // TODO: Remove.
-        const Batch* result = nullptr;
+    const Batch* ConstFind(uint64 id) const {
+        const unsigned index = FindIndex(id);
+        return index != (unsigned)-1 ? &batches[index] : nullptr;
+    }
+
+    const Batch* ConstFindIndex(uint64 id, unsigned& out_index) const {
+        const unsigned index = FindIndex(id);
+        if (index == (unsigned)-1)
+            return nullptr;
+        out_index = index;
+        return &batches[index];
+    }
+
+    void IndexBatches() {
+        batch_index.Clear();
         batches.ConstProcessIndex([&](auto& batch, unsigned index) {
-            if (batch.Id() == id) {
-                result = &batch;
-                out_index = index;
-            }
+            batch_index.Add(batch.Id(), index);
         });
-        return result;
     }
 
-    void ComputeBounds() {
+    void Invalidate(Batch& batch) {
+        batch.Invalidate();
+        dirty = true;
+    }
+
+    bool IsDirty() const { return dirty; }
+
+    void ComputeBounds() { // Only dirty batches are recomputed, the others reuse their boxes.
         Vector3 min(Math::Large), max(-Math::Large);
         batches.Process([&](auto& batch) {
             batch.ComputeBounds(min, max);
         });
+        box = Aabb(min, max);
         new(&sphere) Sphere(min, max);
+        dirty = false;
     }
 };
 
-struct Cell : public Data {
-protected:
-    struct Table {
-        enum Type {
-            Script = 0,
-            Follow,
-            Source,
-            Camera,
-            Render,
-            Count
-        };
-
-        uint32 size = 0;
-        uint32 count = 0;
-        uint32 offset = 0;
-
-        Table() {}
-        Table(uint32 size, uint32 count) : size(size), count(count) {}
-
-        ::size TotalSize() const { return size * count; }
-    };
-
-    uint32 cluster_count = 0;
-    uint32 cluster_offset = 0;
-    FixedArray<Table, Table::Count> cluster_tables;
-
-public:
-    Cell(uint64 id, const String& name)
-        : Data(id, name) {}
-};
-
 class Dictionary : public Data {
-    static const unsigned EntryMaxCount = 64;
-
 protected:
-    struct Entry {
+    struct Entry { // Open-addressed slot in the data, hash 0 marks an empty slot.
         uint32 hash = 0;
         float value = 0.0f;
 
@@ -215,20 +286,25 @@ protected:
         Entry(uint32 hash, float value)
             : hash(hash), value(value) {}
     };
-    Array<Entry, EntryMaxCount> entries;
-
-public:
-    Dictionary(uint64 id, const String& name)
-        : Data(id, name) {}
 
-    float Find(uint32 hash) const {
-        float value = 0.0f;
-        entries.ConstProcess([&](const auto& entry) {
-            if (entry.hash == hash)
-                value = entry.value;
-        });
-        return value;
+    uint32 entry_count = 0;
+    uint32 slot_mask = 0;
+    uint32 probe_max_count = 0; // Longest probe sequence, bounds misses.
+
+    float Find(const Entry* slots, uint32 hash) const {
+        for (uint32 i = 0; i < probe_max_count; ++i) {
+            const auto& slot = slots[(hash + i) & slot_mask];
+            if (slot.hash == hash)
+                return slot.value;
+            if (slot.hash == 0)
+                break;
+        }
+        return 0.0f;
     }
+
+public:
+    Dictionary(uint64 id)
+        : Data(id) {}
 };
 
 class Follow : public Data {
@@ -248,67 +324,98 @@ protected:
     float rotation_speed = 0.f;
     uint64 followed_cluster_id = 0;
     uint64 followed_batch_id = 0;
-    uint8 bucket_index = 0;
     Type type = Type::None;
 
 public:
-    Follow(uint64 id, const String& name)
-        : Data(id, name) {}
+    Follow(uint64 id)
+        : Data(id) {}
 
     uint64 FollowedClusterId() const { return followed_cluster_id; }
     uint64 FollowedBatchId() const { return followed_batch_id; }
-    uint8 GetBucketIndex() const { return bucket_index; }
-
-    static const unsigned BucketMaxCount = 2;
 
-    void Update(Batch& batch, const Batch& followed_batch) {
+    bool Update(Batch& batch, const Batch& followed_batch) { // Returns false when no instance moved.
         switch (type) {
-        case Type::Carrot: Carrot(batch, followed_batch); break;
-        case Type::Mirror: Mirror(batch, followed_batch); break;
-        case Type::Spline: Spline(batch, followed_batch); break;
-        default: break;
+        case Type::Carrot: return Carrot(batch, followed_batch);
+        case Type::Mirror: return Mirror(batch, followed_batch);
+        case Type::Spline: return Spline(batch, followed_batch);
+        default: return false;
         }
     }
 
-    void Carrot(Batch& batch, const Batch& followed_batch) const {
-        batch.Instances().ProcessIndex([&](auto& instance, unsigned index) {
-            instance.rotation = instance.rotation.Slerp(followed_batch.Instances()[index].rotation, rotation_speed);
-            instance.position = instance.position.Lerp(followed_batch.Instances()[index].position, position_speed);
-        });
+    bool Carrot(Batch& batch, const Batch& followed_batch) const { // Four instances at a time.
+        Instance* instances = batch.Instances().Values();
+        const Instance* targets = followed_batch.Instances().Values();
+        const unsigned count = batch.Instances().UsedCount();
+        unsigned moved_mask = 0;
+        for (unsigned index = 0; index < count; index += 4) {
+            const unsigned lane_count = Math::Min(count - index, 4u);
+            InstanceLanes lanes(&instances[index], lane_count);
+            const InstanceLanes target(&targets[index], lane_count);
+            const auto rotation = lanes.rotation.Slerp(target.rotation, rotation_speed);
+            const auto position = lanes.position.Lerp(target.position, Float4(position_speed));
+            const Float4 moved = (lanes.rotation.SquareDistance(rotation) > Float4(0.f)) | (lanes.position.SquareDistance(position) > Float4(0.f));
+            moved_mask |= moved.Mask() & ((1u << lane_count) - 1);
+            lanes.rotation = rotation;
+            lanes.position = position;
+            lanes.Store(&instances[index], lane_count);
+        }
+        return moved_mask != 0;
     }
 
-    void Mirror(Batch& batch, const Batch& followed_batch) const {
+    bool Mirror(Batch& batch, const Batch& followed_batch) const {
         const auto& target_rotation = followed_batch.Instances()[0].rotation;
         const auto& target_position = followed_batch.Instances()[0].position;
-        batch.Instances()[0].rotation = target_rotation.Conjugate();
-        batch.Instances()[0].position = Vector3(target_position.x, -target_position.y, target_position.z);
-    }
-
-    void Spline(Batch& batch, const Batch& followed_batch) {
-        batch.Instances().ProcessIndex([&](auto& instance, unsigned index) {
-            const auto& target_rotation = followed_batch.Instances()[index].rotation;
-            const auto& target_position = followed_batch.Instances()[index].position;
-            if ((instance.rotation.SquareDistance(target_rotation) > 0.001f) || // TODO: Add threshold to data.
-                (instance.position.SquareDistance(target_position) > 0.001f)) {
-                instance.rotation = instance.rotation.Slerp(target_rotation, rotation_speed);
-                instance.position = Vector3::CubicHermite(instance.position, target_position, tangent_begin, tangent_end, weights[index]);
-                weights[index] = Math::Lerp(weights[index], 1.f, position_speed);
-            }
-            else {
-                initial_positions[index] = target_position;
-                instance.rotation = target_rotation;
-                instance.position = target_position;
-                weights[index] = 0.f;
+        const auto rotation = target_rotation.Conjugate();
+        const auto position = Vector3(target_position.x, -target_position.y, target_position.z);
+        auto& instance = batch.Instances()[0];
+        const bool moved = (instance.rotation.SquareDistance(rotation) > 0.f) || !(instance.position == position);
+        instance.rotation = rotation;
+        instance.position = position;
+        return moved;
+    }
+
+    bool Spline(Batch& batch, const Batch& followed_batch) { // Four instances at a time, settled lanes snap to their target.
+        Instance* instances = batch.Instances().Values();
+        const Instance* targets = followed_batch.Instances().Values();
+        const unsigned count = batch.Instances().UsedCount();
+        const Vector3Lanes tangent_begin_lanes(tangent_begin);
+        const Vector3Lanes tangent_end_lanes(tangent_end);
+        const Float4 threshold(0.001f); // TODO: Add threshold to data.
+        unsigned moved_mask = 0;
+        for (unsigned index = 0; index < count; index += 4) {
+            const unsigned lane_count = Math::Min(count - index, 4u);
+            InstanceLanes lanes(&instances[index], lane_count);
+            const InstanceLanes target(&targets[index], lane_count);
+            const Float4 weight = Float4::Load(&weights[index]);
+            const Float4 moving = (lanes.rotation.SquareDistance(target.rotation) > threshold) | (lanes.position.SquareDistance(target.position) > threshold);
+            const Float4 off_target = (lanes.rotation.SquareDistance(target.rotation) > Float4(0.f)) | (lanes.position.SquareDistance(target.position) > Float4(0.f)); // Settled lanes still move when they snap.
+            moved_mask |= off_target.Mask() & ((1u << lane_count) - 1);
+            const auto rotation = lanes.rotation.Slerp(target.rotation, rotation_speed);
+            const auto position = Vector3Lanes::CubicHermite(lanes.position, target.position, tangent_begin_lanes, tangent_end_lanes, weight);
+            lanes.rotation = QuaternionLanes::Select(moving, rotation, target.rotation);
+            lanes.position = Vector3Lanes::Select(moving, position, target.position);
+            lanes.Store(&instances[index], lane_count);
+
+            float new_weights[4];
+            Float4::Select(moving, weight + (Float4(1.f) - weight) * Float4(position_speed), Float4(0.f)).Store(new_weights);
+            const unsigned moving_mask = moving.Mask();
+            for (unsigned lane = 0; lane < lane_count; ++lane) {
+                weights[index + lane] = new_weights[lane];
+                if ((moving_mask & (1 << lane)) == 0)
+                    initial_positions[index + lane] = targets[index + lane].position;
             }
-        });
+        }
+        return moved_mask != 0;
     }
 };
 
 struct ClusterId {
     uint64 cluster_id = 0;
+    uint32 cluster_index = 0; // Into the cell sorted clusters.
 
     ClusterId() {}
     ClusterId(uint64 cluster_id) : cluster_id(cluster_id) {}
+    ClusterId(uint64 cluster_id, uint32 cluster_index) : cluster_id(cluster_id), cluster_index(cluster_index) {}
 
     bool operator>(const ClusterId& other) const { return cluster_id > other.cluster_id; }
     bool operator<(const ClusterId& other) const { return cluster_id < other.cluster_id; }
@@ -319,7 +426,7 @@ struct FollowCluster : public ClusterId {
     Array<uint64, Cluster::BatchMaxCount> follow_ids;
 
     FollowCluster() {}
-    FollowCluster(uint64 cluster_id) : ClusterId(cluster_id) {}
+    FollowCluster(uint64 cluster_id, uint32 cluster_index) : ClusterId(cluster_id, cluster_index) {}
     FollowCluster(const FollowCluster& other) { memcpy(this, &other, sizeof(FollowCluster)); }
 
     FollowCluster& operator=(const FollowCluster& other) { memcpy(this, &other, sizeof(FollowCluster)); return *this; }
@@ -327,10 +434,24 @@ struct FollowCluster : public ClusterId {
     void AddFollowId(uint64 follow_id) { follow_ids.Add(follow_id); }
 };
 
+struct FollowRecord { // One batch following another, sorted by the packager so targets update first.
+    uint64 follow_id = 0;
+    DataHandle follow = InvalidDataHandle;
+    uint16 level = 0; // Records of the same level are independent.
+    uint32 cluster_index = 0;
+    uint32 batch_index = 0;
+    uint32 followed_cluster_index = 0;
+    uint32 followed_batch_index = 0;
+
+    FollowRecord() {}
+    FollowRecord(uint64 follow_id, uint32 cluster_index, uint32 batch_index)
+        : follow_id(follow_id), cluster_index(cluster_index), batch_index(batch_index) {}
+};
+
 class Source : public Data {
 public:
-    Source(uint64 id, const String& name)
-        : Data(id, name) {}
+    Source(uint64 id)
+        : Data(id) {}
 };
 
 struct SourceCluster : public ClusterId {
@@ -338,7 +459,7 @@ struct SourceCluster : public ClusterId {
     Array<uint64, Cluster::BatchMaxCount> source_ids;
 
     SourceCluster() {}
-    SourceCluster(uint64 cluster_id, uint64 bank_id) : ClusterId(cluster_id), bank_id(bank_id) {}
+    SourceCluster(uint64 cluster_id, uint32 cluster_index, uint64 bank_id) : ClusterId(cluster_id, cluster_index), bank_id(bank_id) {}
     SourceCluster(const SourceCluster& other) { memcpy(this, &other, sizeof(SourceCluster)); }
 
     SourceCluster& operator=(const SourceCluster& other) { memcpy(this, &other, sizeof(SourceCluster)); return *this; }
@@ -351,8 +472,8 @@ protected:
     uint32 flags = 0;
 
 public:
-    Flags(uint64 id, const String& name)
-        : Data(id, name) {}
+    Flags(uint64 id)
+        : Data(id) {}
 
     bool Check(const uint32 include_flags, const uint32 exclude_flags) const {
         if ((flags & include_flags) != include_flags)
@@ -373,8 +494,8 @@ protected:
     FixedArray<Vector4, UniformMaxCount> uniforms;
 
 public:
-    Uniforms(uint64 id, const String& name)
-        : Data(id, name) {}
+    Uniforms(uint64 id)
+        : Data(id) {}
 
     Vector4* Values() { return uniforms.Values(); }
     const Vector4* Values() const { return uniforms.Values(); }
@@ -388,10 +509,10 @@ public:
     static const unsigned ColorAttachmentMaxCount = 4;
 
     struct Pass {
-        Array<uint64, SurfaceMaxCount> auto_surface_ids;
-        uint64 auto_shader_id = 0;
-        uint64 auto_mesh_id = 0;
-        uint64 auto_uniforms_id = 0;
+        Array<DataHandle, SurfaceMaxCount> auto_surfaces;
+        DataHandle auto_shader = InvalidDataHandle;
+        DataHandle auto_mesh = InvalidDataHandle;
+        DataHandle auto_uniforms = InvalidDataHandle;
         uint32 technique_id = 0;
         uint32 include_flags = 0;
         uint32 exclude_flags = 0;
@@ -400,14 +521,27 @@ public:
 
     struct Target {
         Array<Pass, PassMaxCount> passes;
-        Array<uint64, ColorAttachmentMaxCount> color_attachment_ids;
-        uint64 depth_stencil_attachment_id = 0;
+        Array<DataHandle, ColorAttachmentMaxCount> color_attachments;
+        DataHandle depth_stencil_attachment = InvalidDataHandle;
         uint32 target_id = 0;
         bool clear_color = true;
         bool clear_depth = true;
         bool last = false;
     };
 
+    struct PassLinks { // Cold ids, resolved into Pass handles by the packager.
+        Array<uint64, SurfaceMaxCount> auto_surface_ids;
+        uint64 auto_shader_id = 0;
+        uint64 auto_mesh_id = 0;
+        uint64 auto_uniforms_id = 0;
+    };
+
+    struct TargetLinks { // Camera data, parallel to targets and unused at runtime.
+        Array<PassLinks, PassMaxCount> passes;
+        Array<uint64, ColorAttachmentMaxCount> color_attachment_ids;
+        uint64 depth_stencil_attachment_id = 0;
+    };
+
     struct Uniforms {
         Matrix view;
         Matrix view_inverse;
@@ -429,8 +563,8 @@ protected:
     float ortho_height = 0.f;
 
 public:
-    Camera(uint64 id, const String& name)
-        : Data(id, name) {}
+    Camera(uint64 id)
+        : Data(id) {}
 
     float Priority() const { return priority; }
     Array<Target, TargetMaxCount>& Targets() { return targets; }
@@ -454,7 +588,7 @@ struct CameraCluster : public ClusterId {
     uint64 camera_id = 0;
 
     CameraCluster() {}
-    CameraCluster(uint64 cluster_id, uint64 camera_id) : ClusterId(cluster_id), camera_id(camera_id) {}
+    CameraCluster(uint64 cluster_id, uint32 cluster_index, uint64 camera_id) : ClusterId(cluster_id, cluster_index), camera_id(camera_id) {}
     CameraCluster(const CameraCluster& other) { memcpy(this, &other, sizeof(CameraCluster)); }
 
     CameraCluster& operator=(const CameraCluster& other) { memcpy(this, &other, sizeof(CameraCluster)); return *this; }
@@ -487,35 +621,29 @@ protected:
     };
 
     Array<Sound, SoundMaxCount> sounds;
+    HashIndex<uint32, SoundMaxCount> sound_index;
 
 public:
-    Bank(uint64 id, const String& name)
-        : Data(id, name) {}
+    Bank(uint64 id)
+        : Data(id) {}
 
     const Sound* FindSound(uint32 sound_id) const {
-        const Sound* result = nullptr;
-        sounds.ConstFind([&](const auto& sound) {
-            if (sound.Id() == sound_id) {
-                result = &sound;
-                return true;
-            }
-            return false;
-        });
-        return result;
+        const unsigned index = sound_index.Find(sound_id, [&](unsigned index) { return sounds[index].Id(); });
+        return index != (unsigned)-1 ? &sounds[index] : nullptr;
     }
 };
 
 class Script : public Data {
 public:
-    Script(uint64 id, const String& name)
-        : Data(id, name) {}
+    Script(uint64 id)
+        : Data(id) {}
 };
 
 struct ScriptCluster : public ClusterId {
     uint64 script_id = 0;
 
-    ScriptCluster(uint64 cluster_id, uint64 script_id)
-        : ClusterId(cluster_id), script_id(script_id) {}
+    ScriptCluster(uint64 cluster_id, uint32 cluster_index, uint64 script_id)
+        : ClusterId(cluster_id, cluster_index), script_id(script_id) {}
     ScriptCluster(const ScriptCluster& other) { memcpy(this, &other, sizeof(ScriptCluster)); }
 
     ScriptCluster& operator=(const ScriptCluster& other) { memcpy(this, &other, sizeof(ScriptCluster)); return *this; }
@@ -562,13 +690,87 @@ class Mesh : public Data {
     Attribute normals;
     Array<Attribute, UVSetMaxCount> uv_sets;
     Array<Attribute, ColorSetMaxCount> color_sets;
+    struct TreeNode { // Four children with bounds quantized inside the node box, one cache line.
+        static const uint32 LeafBit = 1u << 31;
+        static const uint32 LeafCountShift = 24;
+        static const uint32 LeafFirstMask = (1u << LeafCountShift) - 1;
+
+        Vector3 origin; // Child bounds are origin + q * scale.
+        Vector3 scale;
+        uint8 min_x[4], min_y[4], min_z[4];
+        uint8 max_x[4], max_y[4], max_z[4];
+        uint32 children[4]; // Node index, or leaf bit with triangle count and first triangle, 0 when empty.
+
+        static Float4 Dequantize(const uint8* q, float origin, float scale) {
+            const float values[4] = { (float)q[0], (float)q[1], (float)q[2], (float)q[3] };
+            return Float4(origin) + Float4::Load(values) * Float4(scale);
+        }
+
+        unsigned Intersect(const Vector3Lanes& from, const Vector3Lanes& inv_direction, float t) const { // Slab test, one bit per child that hits.
+            const Float4 x1 = (Dequantize(min_x, origin.x, scale.x) - from.x) * inv_direction.x, x2 = (Dequantize(max_x, origin.x, scale.x) - from.x) * inv_direction.x;
+            const Float4 y1 = (Dequantize(min_y, origin.y, scale.y) - from.y) * inv_direction.y, y2 = (Dequantize(max_y, origin.y, scale.y) - from.y) * inv_direction.y;
+            const Float4 z1 = (Dequantize(min_z, origin.z, scale.z) - from.z) * inv_direction.z, z2 = (Dequantize(max_z, origin.z, scale.z) - from.z) * inv_direction.z;
+            const Float4 t_near = x1.Min(x2).Max(y1.Min(y2)).Max(z1.Min(z2)).Max(Float4(0.f));
+            const Float4 t_far = x1.Max(x2).Min(y1.Max(y2)).Min(z1.Max(z2)).Min(Float4(t));
+            return (t_far >= t_near).Mask();
+        }
+    };
+
+    static_assert(sizeof(TreeNode) == 64);
+
+    static const unsigned TreeStackMaxCount = 64;
+
     Attribute indices;
     uint32 vertex_count = 0;
     uint32 index_count = 0;
+    uint32 tree_offset = 0; // Triangle tree appended after the indices, absent without positions.
+    uint32 tree_node_count = 0;
+    uint32 triangles_offset = 0; // Triangles copied in leaf order.
+    Vector3 extents; // Half size of the box centered on the mesh origin that holds every vertex.
+    bool occluder = false; // Rasterized into the occlusion buffer, meant for a few large and simple meshes.
+
+    static float Invert(float d) { return 1.f / (Math::Abs(d) < 1e-20f ? Math::CopySign(1e-20f, d) : d); }
 
 public:
-    Mesh(uint64 id, const String& name)
-        : Data(id, name) {}
+    Mesh(uint64 id)
+        : Data(id) {}
+
+    bool HasTree() const { return tree_node_count > 0; }
+    const Vector3& Extents() const { return extents; }
+    bool IsOccluder() const { return occluder && (tree_node_count > 0); }
+    unsigned TriangleCount() const { return tree_node_count > 0 ? index_count / 3 : 0; }
+    const Triangle* Triangles(const uint8* mem) const { return (const Triangle*)(mem + triangles_offset); }
+
+    bool Intersect(const uint8* mem, const Vector3& from, const Vector3& direction, float& t) const { // Closest triangle in mesh space, t is the distance limit on entry.
+        const auto* nodes = (const TreeNode*)(mem + tree_offset);
+        const auto* triangles = (const Triangle*)(mem + triangles_offset);
+        const Vector3Lanes from_lanes(from);
+        const Vector3Lanes inv_direction(Vector3(Invert(direction.x), Invert(direction.y), Invert(direction.z)));
+        uint32 stack[TreeStackMaxCount];
+        unsigned stack_count = 0;
+        bool hit = false;
+        if (tree_node_count > 0)
+            stack[stack_count++] = 0;
+        while (stack_count > 0) {
+            const auto& node = nodes[stack[--stack_count]];
+            const unsigned mask = node.Intersect(from_lanes, inv_direction, t);
+            for (unsigned i = 0; i < 4; ++i) {
+                const uint32 child = node.children[i];
+                if ((child == 0) || !(mask & (1u << i)))
+                    continue;
+                if (child & TreeNode::LeafBit) {
+                    const unsigned first = child & TreeNode::LeafFirstMask;
+                    const unsigned count = (child & ~TreeNode::LeafBit) >> TreeNode::LeafCountShift;
+                    for (unsigned j = 0; j < count; ++j)
+                        hit |= triangles[first + j].Intersect(from, direction, t);
+                } else {
+                    DEBUG_ONLY(if (stack_count >= TreeStackMaxCount) throw Exception("Mesh tree stack overflow");)
+                    stack[stack_count++] = child;
+                }
+            }
+        }
+        return hit;
+    }
 };
 
 enum class PixelFormat : uint8 {
@@ -604,16 +806,11 @@ class Shader : public Data {
 public:
     static const unsigned TechniqueMaxCount = 16;
 
-    Shader(uint64 id, const String& name)
-        : Data(id, name) {}
+    Shader(uint64 id)
+        : Data(id) {}
 
     unsigned FindTechnique(const uint32 technique_id) const {
-        unsigned result = (unsigned)-1;
-        techniques.ConstProcessIndex([&](const auto& technique, unsigned index) {
-            if (technique.ID() == technique_id)
-                result = index;
-        });
-        return result;
+        return technique_index.Find(technique_id, [&](unsigned index) { return techniques[index].ID(); });
     }
 
     static const unsigned InputMaxCount = 4;
@@ -725,6 +922,7 @@ public:
     };
 
     Array<Technique, TechniqueMaxCount> techniques;
+    HashIndex<uint32, TechniqueMaxCount> technique_index;
     Array<Input, InputMaxCount> inputs;
     Array<Descriptor, DescriptorMaxCount> descriptors;
     Array<Sampler, SamplerMaxCount> samplers;
@@ -750,8 +948,8 @@ protected:
     PixelFormat pixel_format = PixelFormat::None;
 
 public:
-    Surface(uint64 id, const String& name)
-        : Data(id, name) {}
+    Surface(uint64 id)
+        : Data(id) {}
 
     unsigned Width() const { return width; }
     unsigned Height() const { return height; }
@@ -759,19 +957,50 @@ public:
 };
 
 struct RenderCluster : public ClusterId {
+    DataHandle flags = InvalidDataHandle;
+    DataHandle shader = InvalidDataHandle;
+    Array<DataHandle, Camera::SurfaceMaxCount> surfaces;
+    Array<DataHandle, Cluster::BatchMaxCount> meshes;
+    Array<DataHandle, Cluster::BatchMaxCount> uniforms;
+    bool has_camera = false; // TODO: Remove.
+
+    RenderCluster() {}
+    RenderCluster(uint64 cluster_id, uint32 cluster_index, bool has_camera)
+        : ClusterId(cluster_id, cluster_index), has_camera(has_camera) {}
+    RenderCluster(const RenderCluster& other) { memcpy(this, &other, sizeof(RenderCluster)); }
+
+    RenderCluster& operator=(const RenderCluster& other) { memcpy(this, &other, sizeof(RenderCluster)); return *this; }
+};
+
+struct RenderLinks : public ClusterId { // Cold ids, resolved into RenderCluster handles by the packager.
     uint64 flags_id = 0;
     uint64 shader_id = 0;
     Array<uint64, Camera::SurfaceMaxCount> surface_ids;
-    bool has_camera = false; // TODO: Remove.
     Array<uint64, Cluster::BatchMaxCount> mesh_ids;
     Array<uint64, Cluster::BatchMaxCount> uniforms_ids;
 
-    RenderCluster() {}
-    RenderCluster(uint64 cluster_id, uint64 flags_id, uint64 shader_id, Array<uint64, Camera::SurfaceMaxCount>& surface_ids, bool has_camera, Array<uint64, Cluster::BatchMaxCount>& mesh_ids, Array<uint64, Cluster::BatchMaxCount>& uniforms_ids)
-        : ClusterId(cluster_id), flags_id(flags_id), shader_id(shader_id), surface_ids(surface_ids), has_camera(has_camera), mesh_ids(mesh_ids), uniforms_ids(uniforms_ids) {}
-    RenderCluster(const RenderCluster& other) { memcpy(this, &other, sizeof(RenderCluster)); }
+    RenderLinks() {}
+    RenderLinks(uint64 cluster_id, uint32 cluster_index, uint64 flags_id, uint64 shader_id, Array<uint64, Camera::SurfaceMaxCount>& surface_ids, Array<uint64, Cluster::BatchMaxCount>& mesh_ids, Array<uint64, Cluster::BatchMaxCount>& uniforms_ids)
+        : ClusterId(cluster_id, cluster_index), flags_id(flags_id), shader_id(shader_id), surface_ids(surface_ids), mesh_ids(mesh_ids), uniforms_ids(uniforms_ids) {}
+    RenderLinks(const RenderLinks& other) { memcpy(this, &other, sizeof(RenderLinks)); }
 
-    RenderCluster& operator=(const RenderCluster& other) { memcpy(this, &other, sizeof(RenderCluster)); return *this; }
+    RenderLinks& operator=(const RenderLinks& other) { memcpy(this, &other, sizeof(RenderLinks)); return *this; }
+};
+
+struct Cell : public Data {
+    struct Image { // Start of the cell data, offsets are self-relative.
+        RelArray<Cluster> clusters;
+        RelArray<ScriptCluster> script_clusters;
+        RelArray<FollowCluster> follow_clusters;
+        RelArray<SourceCluster> source_clusters;
+        RelArray<CameraCluster> camera_clusters;
+        RelArray<RenderCluster> render_clusters;
+        RelArray<RenderLinks> render_links; // Parallel to render_clusters, unused at runtime.
+        RelArray<FollowRecord> follow_records;
+    };
+
+    Cell(uint64 id)
+        : Data(id) {}
 };
 
 
@@ -792,6 +1021,14 @@ public:
         bool operator==(const Resource& other) const { return data_id == other.data_id; }
     };
 
+    struct Range { // Headers of one type, sorted ids keep types contiguous.
+        uint32 begin = 0;
+        uint32 end = 0;
+
+        Range() {}
+        Range(uint32 begin, uint32 end) : begin(begin), end(end) {}
+    };
+
     class Asset {
         const uint8* mem = nullptr;
         size size = 0;
@@ -807,9 +1044,34 @@ public:
     };
 
 private:
-    ReadCopyFile file;
+    ReadOnlyFile file;
+    ProxyArray<Range> ranges;
     ProxyArray<Resource> headers;
     ProxyArray<Resource> datas;
+    ProxyArray<Resource> names; // Debug only, strings live at the end of the bundle.
+    Arena arena; // Writable copies of dynamic headers, static ones point into the mapping.
+    uint8** slots = nullptr;
+
+    static size SlotSize(const Resource& resource) { return Arena::AlignSize(resource.length + Data::DynamicSize); }
+
+    void CopyHeaders() {
+        size arena_size = Arena::AlignSize(headers.Count() * sizeof(uint8*));
+        headers.ConstProcess([&](const auto& resource) {
+            if (Data::IsDynamic(Data::DataTypeFromId(resource.data_id)))
+                arena_size += SlotSize(resource);
+        });
+        new(&arena) Arena(arena_size, Memory::Tag::Bundle);
+        slots = (uint8**)arena.Allocate(headers.Count() * sizeof(uint8*));
+        headers.ConstProcessIndex([&](const auto& resource, unsigned index) {
+            auto* header = (uint8*)file.Pointer() + resource.offset;
+            if (Data::IsDynamic(Data::DataTypeFromId(resource.data_id))) {
+                slots[index] = arena.Allocate(SlotSize(resource));
+                memcpy(slots[index], header, resource.length);
+            } else {
+                slots[index] = header;
+            }
+        });
+    }
 
 public:
     Bundle() : file(Name()) {
@@ -818,25 +1080,58 @@ public:
         in += sizeof(uint32);
         const unsigned data_count = *(uint32*)in;
         in += sizeof(uint32);
+        const unsigned name_count = *(uint32*)in;
+        in += sizeof(uint32);
+        new(&ranges) ProxyArray<Range>((Range*)in, (unsigned)Data::Type::Count);
+        in += (unsigned)Data::Type::Count * sizeof(Range);
         new(&headers) ProxyArray<Resource>((Resource*)in, header_count);
         in += header_count * sizeof(Resource);
         new(&datas) ProxyArray<Resource>((Resource*)in, data_count);
         in += data_count * sizeof(Resource);
+        DEBUG_ONLY(new(&names) ProxyArray<Resource>((Resource*)in, name_count);)
+        in += name_count * sizeof(Resource);
+        CopyHeaders();
     }
 
+    size MappedSize() const { return file.Size(); }
+    size ResidentSize() const { return file.ResidentSize(); }
+    size ArenaSize() const { return arena.Used(); }
+
     Asset FindData(uint64 data_id) const {
         const auto* resource = datas.ConstBinaryFind(data_id);
         return resource ? Asset((uint8*)file.Pointer() + resource->offset, resource->length) : Asset(nullptr, 0);
     }
 
+    const char* FindName(uint64 id) const {
+        const auto* resource = names.ConstBinaryFind(id);
+        return resource ? (char*)file.Pointer() + resource->offset : nullptr;
+    }
+
+    DataHandle FindHandle(uint64 data_id) const {
+        const auto* resource = headers.ConstBinaryFind(data_id);
+        return resource ? (DataHandle)(resource - headers.Values()) : InvalidDataHandle;
+    }
+
+    template <typename T> T* Get(DataHandle handle) {
+        DEBUG_ONLY(if ((handle != InvalidDataHandle) && (handle >= headers.Count())) throw Exception("Out-of-bounds");)
+        return handle != InvalidDataHandle ? (T*)slots[handle] : nullptr;
+    }
+
     template <typename T> T* Find(uint64 data_id) {
         const auto* resource = headers.ConstBinaryFind(data_id);
-        return resource ? (T*)((uint8*)file.Pointer() + resource->offset) : nullptr;
+        return resource ? (T*)slots[resource - headers.Values()] : nullptr;
     }
 
     template<typename F> void Process(F func) {
-        headers.Process([&](auto& resource) {
-            func(*(Data*)((uint8*)file.Pointer() + resource.offset));
+        headers.ProcessIndex([&](auto& resource, unsigned index) {
+            func(*(Data*)slots[index]);
         });
     }
+
+    template<Data::Type TYPE, typename F> void ProcessType(F func) {
+        const auto& range = ranges[(unsigned)TYPE];
+        for (unsigned index = range.begin; index < range.end; ++index) {
+            func(*(Data*)slots[index]);
+        }
+    }
 };
\ No newline at end of file
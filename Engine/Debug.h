@@ -102,9 +102,14 @@ public:
         frame_begin_times[debug_index] = now;
     }
 
-    void Draw(Profile& profile, DebugDraw& debug_draw, unsigned window_witdh, unsigned window_height) {
+    void Draw(Profile& profile, const RenderStats& stats, DebugDraw& debug_draw, unsigned window_witdh, unsigned window_height) {
         if (is_jobs_enabled) {
             DrawTracks(profile, debug_draw, window_witdh, window_height);
+            DrawStats(stats, debug_draw, window_witdh, window_height);
+        } else {
+            profile.Tracks().Process([&](auto& track) {
+                track.Clear();
+            });
         }
     }
 
@@ -153,11 +158,6 @@ private:
     bool is_jobs_enabled = false;
 
     void DrawTracks(Profile& profile, DebugDraw& debug_draw, unsigned window_witdh, unsigned window_height) {
-        if (!is_jobs_enabled) {
-            profile.Tracks().Process([&](auto& track) {
-                track.Clear();
-            });
-        }
         const unsigned begin_index = (debug_index + 1) % Timings::BufferCount;
         const unsigned end_index = (debug_index + 2) % Timings::BufferCount;
         const uint64 frame_begin_time = frame_begin_times[begin_index];
@@ -168,6 +168,37 @@ private:
         });
     }
 
+    // One bar per counter, in RenderStats order, with log2 length (full width at 2^24).
+    static void DrawStats(const RenderStats& stats, DebugDraw& debug_draw, unsigned window_witdh, unsigned window_height) {
+        const uint64 counts[] = { stats.cameras, stats.targets, stats.passes, stats.clusters_tested, stats.clusters_culled,
+            stats.batches_tested, stats.batches_culled, stats.instances_culled, stats.occlusion_culled, stats.draws,
+            stats.instances, stats.shader_switches, stats.surface_binds, stats.constant_updates, stats.stack_bytes };
+        const Color colors[] = { Color::White, Color::Silver, Color::Gray, Color::Lime, Color::Green,
+            Color::Teal, Color::Blue, Color::Purple, Color::Orange, Color::Red,
+            Color::Maroon, Color::Yellow, Color::Olive, Color::Aqua, Color::Fuschia };
+        const unsigned count = sizeof(counts) / sizeof(counts[0]);
+        static_assert(count == sizeof(colors) / sizeof(colors[0]));
+        Matrix proj, proj_inverse;
+        Matrix::OrthoLH(2.f, 2.f, -1.f, 1.f, proj, proj_inverse);
+        const float pixel_size_u = 1.f / window_witdh;
+        const float pixel_size_v = 1.f / window_height;
+        const float left = 20.f * pixel_size_u;
+        const float span = 280.f * pixel_size_u;
+        const float bar_v = 6.f * pixel_size_v;
+        unsigned vertex_count = 0;
+        const size uniform_buffer_offset = debug_draw.PushData(sizeof(Matrix), (uint8*)&proj);
+        const size vertex_buffer_offset = debug_draw.AlignBufferOffset();
+        for (unsigned i = 0; i < count; ++i) {
+            const float bottom = 1.f - 80.f * pixel_size_v - i * (bar_v + 2.f * pixel_size_v);
+            const float length = Math::Min((float)Math::Log2((unsigned)Math::Min(counts[i] + 1, (uint64)0xFFFFFFFF)) / 24.f, 1.f);
+            DrawQuad(debug_draw, left, left + Math::Max(length * span, pixel_size_u), bottom - bar_v, bottom, -0.999f, colors[i], vertex_count);
+        }
+        debug_draw.AlignBufferOffset();
+        debug_draw.SetConstantBuffer(uniform_buffer_offset);
+        debug_draw.SetVertexBuffer(vertex_buffer_offset, vertex_count);
+        debug_draw.DrawPrimitives(vertex_count, true);
+    }
+
     static void DrawTrack(DebugDraw& debug_draw, StateJobs& state, Track& track, unsigned i) {
         const float bar_v = 14.f * state.pixel_size_v;
         const float capture_v = 0.65f;
@@ -211,7 +242,7 @@ private:
                 stop = true;
             const auto begin_time = Math::Clamp(capture.begin_time, state.frame_begin_time, state.frame_end_time);
             const auto end_time = Math::Clamp(capture.end_time, state.frame_begin_time, state.frame_end_time);
-            DrawCapture(debug_draw, state, track, begin_time, end_time, capture.color, vertex_count);
+            DrawCapture(debug_draw, state, track, begin_time, end_time, capture.color, capture.depth, vertex_count);
             return remove;
         });
         debug_draw.AlignBufferOffset();
@@ -220,14 +251,15 @@ private:
         debug_draw.DrawPrimitives(vertex_count, true);
     }
 
-    static void DrawCapture(DebugDraw& debug_draw, const StateJobs& state, const Track& track, uint64 begin_time, uint64 end_time, Color color, unsigned& vertex_count) {
+    static void DrawCapture(DebugDraw& debug_draw, const StateJobs& state, const Track& track, uint64 begin_time, uint64 end_time, Color color, unsigned depth, unsigned& vertex_count) {
         const float capture_begin = (float)(begin_time - state.frame_begin_time) / state.frame_span;
         const float capture_end = (float)(end_time - state.frame_begin_time) / state.frame_span;
         const float capture_left = state.bound_left + capture_begin * state.bound_span;
         const float capture_right = state.bound_left + capture_end * state.bound_span;
         const float left = capture_left + state.border;
         const float right = capture_right + state.border;
-        DrawQuad(debug_draw, left, right, state.capture_top, state.capture_bottom, state.z_captures, color, vertex_count);
+        const float inset = (state.capture_bottom - state.capture_top) * 0.15f * Math::Min(depth, 3u);
+        DrawQuad(debug_draw, left, right, state.capture_top + inset, state.capture_bottom, state.z_captures - depth * 0.0001f, color, vertex_count);
     }
 
     static void DrawLine(DebugDraw& debug_draw, float left, float right, float top, float bottom, float z, Color color, unsigned& vertex_count) {
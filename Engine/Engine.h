@@ -10,7 +10,7 @@ public:
     Stack() {}
     Stack(Context* context) {
         buffers.Process([&](auto& buffer) {
-            new(&buffer) Buffer(*context, StackSize);
+            new(&buffer) Buffer(*context, StackSize, Memory::Tag::Stack);
         });
     }
 
@@ -26,6 +26,8 @@ public:
         gpu = buffers[index].GPU() + offset;
         offset += aligned_size;
     }
+
+    size Used() const { return offset; }
 };
 
 struct ClusterDynamic : public NoCopy {
@@ -35,20 +37,18 @@ struct ClusterDynamic : public NoCopy {
 };
 
 struct ScriptClusterDynamic : public ScriptCluster, ClusterDynamic {
-    char padding[Cluster::DynamicSize - sizeof(ClusterDynamic)];
 };
 
 struct FollowClusterDynamic : public FollowCluster, ClusterDynamic {
-    char padding[Cluster::DynamicSize - sizeof(ClusterDynamic)];
 };
 
 struct RenderClusterDynamic : public RenderCluster, ClusterDynamic {
-    char padding[Cluster::DynamicSize - sizeof(ClusterDynamic)];
+    unsigned render_index = 0; // Bit in the cluster sets.
+    FixedArray<uint32, Cluster::BatchMaxCount> proxy_begins; // First broadphase proxy of each batch.
 };
 
 struct SourceClusterDynamic : public SourceCluster, ClusterDynamic {
     FixedArray<Voice, Cluster::BatchMaxCount> voices;
-    char padding[Cluster::DynamicSize - sizeof(ClusterDynamic) - sizeof(FixedArray<Voice, Cluster::BatchMaxCount>)];
 
     void Load(Cluster* cluster, Context& context) {
         ClusterDynamic::Load(cluster, context);
@@ -63,7 +63,8 @@ struct CameraClusterDynamic : public CameraCluster, ClusterDynamic {
     uint64 camera_uniforms_gpu = 0;
     Camera::Uniforms* camera_uniforms_cpu = nullptr;
     Timings timings;
-    char padding[Cluster::DynamicSize - sizeof(ClusterDynamic) - sizeof(CommandList) - sizeof(uint64) - sizeof(Camera::Uniforms*) - sizeof(Timings)];
+    unsigned draw_range_begin = 0; // First pass range in the draw list.
+    unsigned visible_set = 0; // Render clusters in its bounds this frame, possibly shared with another camera.
 
     void Load(Cluster* cluster, Context& context) {
         ClusterDynamic::Load(cluster, context);
@@ -72,22 +73,21 @@ struct CameraClusterDynamic : public CameraCluster, ClusterDynamic {
     }
 };
 
-static_assert(sizeof(ScriptClusterDynamic) == (sizeof(ScriptCluster) + Cluster::DynamicSize));
-static_assert(sizeof(FollowClusterDynamic) == (sizeof(FollowCluster) + Cluster::DynamicSize));
-static_assert(sizeof(RenderClusterDynamic) == (sizeof(RenderCluster) + Cluster::DynamicSize));
-static_assert(sizeof(SourceClusterDynamic) == (sizeof(SourceCluster) + Cluster::DynamicSize));
-static_assert(sizeof(CameraClusterDynamic) == (sizeof(CameraCluster) + Cluster::DynamicSize));
-
 class CellDynamic : public Cell {
-    Cluster* FindCluster(uint64 cluster_id) {
-        return clusters.BinaryFind((Cluster&)Named(cluster_id));
+    Arena arena; // Mutable copies of the mapped cluster tables, destroyed last.
+
+    template <typename E> static size TableSize(const RelArray<E>& entries, size dynamic_size) {
+        return Arena::AlignSize(entries.Count() * dynamic_size);
     }
 
-    template <typename C> void LoadTable(ProxyArray<C>& clusters_dynamic, const Table& table, const uint8* data, Context& context) {
-        new(&clusters_dynamic) ProxyArray<C>((C*)(data + table.offset), table.count);
+    template <typename C, typename E> void LoadTable(ProxyArray<C>& clusters_dynamic, const RelArray<E>& entries, Context& context) {
+        auto* values = (C*)arena.Allocate(entries.Count() * sizeof(C));
+        entries.ConstProcessIndex([&](const auto& entry, unsigned index) {
+            memcpy(&values[index], &entry, sizeof(E)); // Read-only entry is the first base.
+        });
+        new(&clusters_dynamic) ProxyArray<C>(values, entries.Count());
         clusters_dynamic.Process([&](auto& cluster_dynamic) {
-            auto* cluster = FindCluster(cluster_dynamic.cluster_id); // TODO: Avoid find.
-            cluster_dynamic.Load(cluster, context);
+            cluster_dynamic.Load(&clusters[cluster_dynamic.cluster_index], context);
         });
     }
 
@@ -98,18 +98,53 @@ public:
     ProxyArray<SourceClusterDynamic> source_clusters;
     ProxyArray<CameraClusterDynamic> camera_clusters;
     ProxyArray<RenderClusterDynamic> render_clusters;
+    ProxyArray<FollowRecord> follow_records;
 
     void Load(const Bundle& bundle, Context& context) {
-        const auto data = bundle.FindData(Id());
-        new(&clusters) ProxyArray<Cluster>((Cluster*)(data.Mem() + cluster_offset), cluster_count);
-        LoadTable(script_clusters, cluster_tables[Table::Script], data.Mem(), context);
-        LoadTable(follow_clusters, cluster_tables[Table::Follow], data.Mem(), context);
-        LoadTable(source_clusters, cluster_tables[Table::Source], data.Mem(), context);
-        LoadTable(camera_clusters, cluster_tables[Table::Camera], data.Mem(), context);
-        LoadTable(render_clusters, cluster_tables[Table::Render], data.Mem(), context);
+        const auto& image = *(const Image*)bundle.FindData(Id()).Mem();
+        const size arena_size = TableSize(image.clusters, sizeof(Cluster)) +
+            TableSize(image.script_clusters, sizeof(ScriptClusterDynamic)) +
+            TableSize(image.follow_clusters, sizeof(FollowClusterDynamic)) +
+            TableSize(image.source_clusters, sizeof(SourceClusterDynamic)) +
+            TableSize(image.camera_clusters, sizeof(CameraClusterDynamic)) +
+            TableSize(image.render_clusters, sizeof(RenderClusterDynamic)) +
+            TableSize(image.follow_records, sizeof(FollowRecord));
+        new(&arena) Arena(arena_size, Memory::Tag::Bundle, Id());
+        auto* cluster_values = (Cluster*)arena.Allocate(image.clusters.Count() * sizeof(Cluster));
+        memcpy(cluster_values, image.clusters.Values(), image.clusters.Count() * sizeof(Cluster));
+        new(&clusters) ProxyArray<Cluster>(cluster_values, image.clusters.Count());
+        LoadTable(script_clusters, image.script_clusters, context);
+        LoadTable(follow_clusters, image.follow_clusters, context);
+        LoadTable(source_clusters, image.source_clusters, context);
+        LoadTable(camera_clusters, image.camera_clusters, context);
+        LoadTable(render_clusters, image.render_clusters, context);
+        auto* record_values = (FollowRecord*)arena.Allocate(image.follow_records.Count() * sizeof(FollowRecord));
+        memcpy(record_values, image.follow_records.Values(), image.follow_records.Count() * sizeof(FollowRecord));
+        new(&follow_records) ProxyArray<FollowRecord>(record_values, image.follow_records.Count());
+    }
+};
+
+class DictionaryDynamic : public Dictionary {
+    const Entry* slots = nullptr;
+
+public:
+    void Load(const Bundle& bundle) {
+        slots = (const Entry*)bundle.FindData(Id()).Mem();
+    }
+
+    float Find(uint32 hash) const {
+        return Dictionary::Find(slots, hash);
     }
 };
 
+static_assert(sizeof(CellDynamic) <= (sizeof(Cell) + Data::DynamicSize));
+static_assert(sizeof(DictionaryDynamic) <= (sizeof(Dictionary) + Data::DynamicSize));
+static_assert(sizeof(MeshDynamic) <= (sizeof(Mesh) + Data::DynamicSize));
+static_assert(sizeof(ShaderDynamic) <= (sizeof(Shader) + Data::DynamicSize));
+static_assert(sizeof(SurfaceDynamic) <= (sizeof(Surface) + Data::DynamicSize));
+static_assert(sizeof(BankDynamic) <= (sizeof(Bank) + Data::DynamicSize));
+static_assert(sizeof(ScriptDynamic) <= (sizeof(Script) + Data::DynamicSize));
+
 class BundleDynamic : public Bundle {
     CellDynamic* cell; // TODO: Put in Bundle.
 
@@ -119,24 +154,64 @@ public:
         cell = Find<CellDynamic>(cell_id);
     }
 
+    template<typename F> void ProcessClusters(F func) {
+        cell->clusters.Process([&](auto& cluster) {
+            func(cluster);
+        });
+    }
+
     template<typename F> void ProcessCameraClusters(F func) {
         cell->camera_clusters.Process([&](auto& camera_cluster) {
             func(camera_cluster);
         });
     }
 
+    template<typename F> void ProcessCameraClustersIndex(F func) {
+        cell->camera_clusters.ProcessIndex([&](auto& camera_cluster, unsigned index) {
+            func(camera_cluster, index);
+        });
+    }
+
+    unsigned CameraClusterCount() const {
+        return cell->camera_clusters.Count();
+    }
+
     template<typename F> void ProcessRenderClusters(F func) {
         cell->render_clusters.Process([&](auto& render_cluster) {
             func(render_cluster);
         });
     }
 
+    template<typename F> void ProcessRenderClustersIndex(F func) {
+        cell->render_clusters.ProcessIndex([&](auto& render_cluster, unsigned index) {
+            func(render_cluster, index);
+        });
+    }
+
+    unsigned RenderClusterCount() const {
+        return cell->render_clusters.Count();
+    }
+
+    RenderClusterDynamic& GetRenderCluster(unsigned index) {
+        return cell->render_clusters[index];
+    }
+
     template<typename F> void ProcessFollowClusters(F func) {
         cell->follow_clusters.Process([&](auto& follow_cluster) {
             func(follow_cluster);
         });
     }
 
+    template<typename F> void ProcessFollowRecords(F func) {
+        cell->follow_records.Process([&](auto& follow_record) {
+            func(follow_record);
+        });
+    }
+
+    Cluster& GetCluster(uint32 cluster_index) {
+        return cell->clusters[cluster_index];
+    }
+
     template<typename F> void ProcessScriptClusters(F func) {
         cell->script_clusters.Process([&](auto& script_cluster) {
             func(script_cluster);
@@ -170,11 +245,964 @@ public:
     }
 };
 
+class SpawnBatch : public NoCopy { // Runtime instances drawn with the mesh and uniforms of a baked batch.
+public:
+    static const unsigned InstanceMaxCount = 1024;
+
+private:
+    uint64 cluster_id = 0;
+    uint64 batch_id = 0;
+    SlotMap<Instance, InstanceMaxCount> instances;
+    uint32 proxies[InstanceMaxCount]; // Broadphase proxy of each slot, moved in place when instances move.
+    Aabb box;
+    bool dirty = false;
+    bool proxies_dirty = false;
+
+public:
+    SpawnBatch(uint64 cluster_id, uint64 batch_id)
+        : cluster_id(cluster_id), batch_id(batch_id) {}
+
+    uint64 ClusterId() const { return cluster_id; }
+    uint64 BatchId() const { return batch_id; }
+    SlotMap<Instance, InstanceMaxCount>& Instances() { return instances; }
+    const SlotMap<Instance, InstanceMaxCount>& Instances() const { return instances; }
+
+    void Invalidate() {
+        dirty = true;
+        proxies_dirty = true;
+    }
+
+    void SetProxy(uint32 handle, uint32 proxy) { proxies[SlotMap<Instance, InstanceMaxCount>::SlotIndex(handle)] = proxy; }
+    uint32 Proxy(uint32 handle) const { return proxies[SlotMap<Instance, InstanceMaxCount>::SlotIndex(handle)]; }
+
+    template<typename F> void MoveProxies(F move) {
+        if (proxies_dirty) {
+            instances.ConstProcessIndex([&](auto& instance, unsigned index) {
+                move(Proxy(instances.Handle(index)), instance);
+            });
+            proxies_dirty = false;
+        }
+    }
+
+    const Aabb& BoundingBox(const Batch& batch) {
+        if (dirty) {
+            box = Aabb();
+            instances.Process([&](auto& instance) {
+                box = box.Merge(batch.InstanceBox(instance));
+            });
+            dirty = false;
+        }
+        return box;
+    }
+};
+
+class Spawns : public NoCopy { // Grows as batches are first spawned into.
+    static const unsigned BatchMinCount = 16;
+
+    SpawnBatch** batches = nullptr;
+    unsigned count = 0;
+    unsigned capacity = 0;
+
+    void Grow() {
+        const unsigned new_capacity = capacity > 0 ? capacity * 2 : BatchMinCount;
+        auto** new_batches = (SpawnBatch**)Memory::Allocate(new_capacity * sizeof(SpawnBatch*), Memory::Tag::Spawn);
+        if (count > 0)
+            memcpy(new_batches, batches, count * sizeof(SpawnBatch*));
+        Memory::Deallocate(batches, capacity * sizeof(SpawnBatch*), Memory::Tag::Spawn);
+        batches = new_batches;
+        capacity = new_capacity;
+    }
+
+public:
+    ~Spawns() {
+        for (unsigned i = 0; i < count; ++i) {
+            batches[i]->~SpawnBatch();
+            Memory::Deallocate(batches[i], sizeof(SpawnBatch), Memory::Tag::Spawn);
+        }
+        Memory::Deallocate(batches, capacity * sizeof(SpawnBatch*), Memory::Tag::Spawn);
+    }
+
+    SpawnBatch* Find(uint64 cluster_id, uint64 batch_id) {
+        for (unsigned i = 0; i < count; ++i)
+            if ((batches[i]->ClusterId() == cluster_id) && (batches[i]->BatchId() == batch_id))
+                return batches[i];
+        return nullptr;
+    }
+
+    template<typename F> void Process(F func) {
+        for (unsigned i = 0; i < count; ++i)
+            func(*batches[i]);
+    }
+
+    SpawnBatch* Add(uint64 cluster_id, uint64 batch_id) {
+        if (count == capacity)
+            Grow();
+        auto* batch = new(Memory::Allocate(sizeof(SpawnBatch), Memory::Tag::Spawn)) SpawnBatch(cluster_id, batch_id);
+        batches[count++] = batch;
+        return batch;
+    }
+
+    Instance* FindInstance(const Id& id) {
+        if (auto* batch = Find(id.cluster_id, id.batch_id))
+            return batch->Instances().Find(id.instance_id & ~Id::SpawnedBit);
+        return nullptr;
+    }
+};
+
+class Hierarchy : public NoCopy { // Parent links between instances, propagated in depth order.
+    static const unsigned NodeMinCount = 256;
+    static const unsigned NodeMaxCount = 0x7FFF; // Node indices are 16 bits.
+    static const uint16 NoParent = (uint16)-1;
+    static const uint16 UnknownDepth = (uint16)-1;
+
+    typedef HashIndex<Id, NodeMaxCount, uint16> Table;
+
+    struct Nodes { // Structure of arrays indexed by node, walked through the depth-sorted order.
+        Id* ids = nullptr;
+        uint16* parents = nullptr;
+        uint16* order = nullptr;
+        uint16* depths = nullptr;
+        uint16* offsets = nullptr; // One past the node count.
+        uint8* dirty = nullptr;
+        Quaternion* local_rotations = nullptr;
+        Vector3* local_positions = nullptr;
+        Quaternion* world_rotations = nullptr;
+        Vector3* world_positions = nullptr;
+    };
+
+    Nodes nodes;
+    Table* table = nullptr;
+    unsigned capacity = 0;
+    unsigned count = 0;
+    unsigned level_count = 0;
+    bool sorted = true;
+
+    template<typename T> void Resize(T*& values, unsigned old_size, unsigned new_size) {
+        auto* new_values = (T*)Memory::Allocate(new_size * sizeof(T), Memory::Tag::Hierarchy);
+        if (count > 0)
+            memcpy((void*)new_values, values, count * sizeof(T));
+        Memory::Deallocate(values, old_size * sizeof(T), Memory::Tag::Hierarchy);
+        values = new_values;
+    }
+
+    template<typename F> void ProcessArrays(F func) {
+        func(nodes.ids, 0);
+        func(nodes.parents, 0);
+        func(nodes.order, 0);
+        func(nodes.depths, 0);
+        func(nodes.offsets, 1);
+        func(nodes.dirty, 0);
+        func(nodes.local_rotations, 0);
+        func(nodes.local_positions, 0);
+        func(nodes.world_rotations, 0);
+        func(nodes.world_positions, 0);
+    }
+
+    void Reserve(unsigned new_capacity) {
+        if (new_capacity <= capacity)
+            return;
+        ProcessArrays([&](auto*& values, unsigned extra) {
+            Resize(values, capacity > 0 ? capacity + extra : 0, new_capacity + extra);
+        });
+        capacity = new_capacity;
+    }
+
+    const Id& IdAt(unsigned index) const { return nodes.ids[index]; }
+
+    unsigned Find(const Id& id) const {
+        return table->Find(id, [&](unsigned index) { return IdAt(index); });
+    }
+
+    unsigned Add(const Id& id, const Instance& instance) {
+        if (count == capacity)
+            Reserve(Math::Min(capacity > 0 ? capacity * 2 : NodeMinCount, NodeMaxCount));
+        const unsigned index = count++;
+        nodes.ids[index] = id;
+        table->Add(id, index);
+        nodes.parents[index] = NoParent;
+        nodes.order[index] = (uint16)index;
+        nodes.dirty[index] = 0;
+        nodes.local_rotations[index] = instance.rotation;
+        nodes.local_positions[index] = instance.position;
+        nodes.world_rotations[index] = instance.rotation;
+        nodes.world_positions[index] = instance.position;
+        return index;
+    }
+
+    void World(unsigned index, Quaternion& rotation, Vector3& position) const { // Composed from the local transforms, so it holds before Update runs.
+        rotation = nodes.local_rotations[index];
+        position = nodes.local_positions[index];
+        for (unsigned parent = nodes.parents[index]; parent != NoParent; parent = nodes.parents[parent]) {
+            position = nodes.local_positions[parent] + nodes.local_rotations[parent].Transform(position);
+            rotation = rotation * nodes.local_rotations[parent];
+        }
+    }
+
+    void SetWorld(unsigned index, const Quaternion& rotation, const Vector3& position) { // Local transform under the current parent.
+        const unsigned parent = nodes.parents[index];
+        if (parent == NoParent) {
+            nodes.local_rotations[index] = rotation;
+            nodes.local_positions[index] = position;
+            return;
+        }
+        Quaternion parent_rotation;
+        Vector3 parent_position;
+        World(parent, parent_rotation, parent_position);
+        const auto inverse_rotation = parent_rotation.Conjugate();
+        nodes.local_rotations[index] = rotation * inverse_rotation;
+        nodes.local_positions[index] = inverse_rotation.Transform(position - parent_position);
+    }
+
+    void Unparent(unsigned index) { // Keeps the world transform.
+        Quaternion rotation;
+        Vector3 position;
+        World(index, rotation, position);
+        nodes.parents[index] = NoParent;
+        SetWorld(index, rotation, position);
+    }
+
+    bool IsAncestor(unsigned ancestor, unsigned index) const {
+        for (unsigned i = index; i != NoParent; i = nodes.parents[i])
+            if (i == ancestor)
+                return true;
+        return false;
+    }
+
+    unsigned Depth(unsigned index) { // Walks up to the first ancestor with a known depth, then fills in the chain.
+        unsigned top = index;
+        unsigned steps = 0;
+        for (; (top != NoParent) && (nodes.depths[top] == UnknownDepth); top = nodes.parents[top])
+            steps++;
+        unsigned depth = (top != NoParent ? nodes.depths[top] : (unsigned)-1) + steps;
+        for (unsigned i = index; i != top; i = nodes.parents[i])
+            nodes.depths[i] = (uint16)depth--;
+        return nodes.depths[index];
+    }
+
+    void Sort() { // Counting sort on depth, parents always come before their children. Leaves offsets[d] at the end of level d.
+        memset(nodes.depths, 0xFF, count * sizeof(uint16));
+        memset(nodes.offsets, 0, (count + 1) * sizeof(uint16));
+        level_count = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            const unsigned depth = Depth(i);
+            nodes.offsets[depth + 1]++;
+            level_count = Math::Max(level_count, depth + 1);
+        }
+        for (unsigned d = 1; d <= count; ++d)
+            nodes.offsets[d] += nodes.offsets[d - 1];
+        for (unsigned i = 0; i < count; ++i)
+            nodes.order[nodes.offsets[nodes.depths[i]]++] = (uint16)i;
+        sorted = true;
+    }
+
+    static QuaternionLanes LoadRotations(const Quaternion* rotations, const unsigned* indices) {
+        QuaternionLanes lanes(Float4::Load(&rotations[indices[0]].x), Float4::Load(&rotations[indices[1]].x), Float4::Load(&rotations[indices[2]].x), Float4::Load(&rotations[indices[3]].x));
+        Float4::Transpose(lanes.x, lanes.y, lanes.z, lanes.w);
+        return lanes;
+    }
+
+    static Vector3Lanes LoadPositions(const Vector3* positions, const unsigned* indices) {
+        float lanes[3][4];
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            lanes[0][lane] = positions[indices[lane]].x;
+            lanes[1][lane] = positions[indices[lane]].y;
+            lanes[2][lane] = positions[indices[lane]].z;
+        }
+        return Vector3Lanes(Float4::Load(lanes[0]), Float4::Load(lanes[1]), Float4::Load(lanes[2]));
+    }
+
+    void StoreWorlds(const QuaternionLanes& rotations, const Vector3Lanes& positions, const unsigned* indices, unsigned mask) {
+        QuaternionLanes r = rotations;
+        Float4::Transpose(r.x, r.y, r.z, r.w);
+        Quaternion out_rotations[4];
+        r.x.Store(&out_rotations[0].x);
+        r.y.Store(&out_rotations[1].x);
+        r.z.Store(&out_rotations[2].x);
+        r.w.Store(&out_rotations[3].x);
+        float out_positions[3][4];
+        positions.x.Store(out_positions[0]);
+        positions.y.Store(out_positions[1]);
+        positions.z.Store(out_positions[2]);
+        for (unsigned lane = 0; lane < 4; ++lane) {
+            if (mask & (1u << lane)) {
+                nodes.world_rotations[indices[lane]] = out_rotations[lane];
+                nodes.world_positions[indices[lane]] = Vector3(out_positions[0][lane], out_positions[1][lane], out_positions[2][lane]);
+            }
+        }
+    }
+
+    void UpdateLevel(unsigned begin, unsigned end) { // Four children at a time, their parents are already up to date.
+        for (unsigned i = begin; i < end; i += 4) {
+            const unsigned lane_count = Math::Min(end - i, 4u);
+            unsigned indices[4];
+            unsigned parents[4];
+            unsigned mask = 0;
+            for (unsigned lane = 0; lane < 4; ++lane) {
+                indices[lane] = nodes.order[i + (lane < lane_count ? lane : 0)];
+                parents[lane] = nodes.parents[indices[lane]];
+                if (lane < lane_count) {
+                    nodes.dirty[indices[lane]] |= nodes.dirty[parents[lane]];
+                    mask |= nodes.dirty[indices[lane]] ? 1u << lane : 0u;
+                }
+            }
+            if (mask == 0)
+                continue;
+            const auto parent_rotations = LoadRotations(nodes.world_rotations, parents);
+            const auto parent_positions = LoadPositions(nodes.world_positions, parents);
+            const auto rotations = LoadRotations(nodes.local_rotations, indices) * parent_rotations;
+            const auto positions = parent_positions + parent_rotations.Transform(LoadPositions(nodes.local_positions, indices));
+            StoreWorlds(rotations, positions, indices, mask);
+        }
+    }
+
+public:
+    Hierarchy() {
+        table = new(Memory::Allocate(sizeof(Table), Memory::Tag::Hierarchy)) Table();
+    }
+
+    ~Hierarchy() {
+        ProcessArrays([&](auto*& values, unsigned extra) {
+            Memory::Deallocate(values, (capacity + extra) * sizeof(*values), Memory::Tag::Hierarchy);
+        });
+        Memory::Deallocate(table, sizeof(Table), Memory::Tag::Hierarchy);
+    }
+
+    // Links id under parent_id keeping its world transform, an empty parent_id unlinks it.
+    template<typename F> void Link(const Id& id, const Id& parent_id, F find_instance) {
+        auto* instance = find_instance(id);
+        if (!instance)
+            return;
+        unsigned index = Find(id);
+        if (!parent_id) {
+            if (index != (unsigned)-1) {
+                Unparent(index);
+                sorted = false;
+            }
+            return;
+        }
+        auto* parent_instance = find_instance(parent_id);
+        if (!parent_instance || (parent_id == id))
+            return;
+        unsigned parent_index = Find(parent_id);
+        if ((index != (unsigned)-1) && (parent_index != (unsigned)-1) && IsAncestor(index, parent_index))
+            return;
+        if (count + (index == (unsigned)-1) + (parent_index == (unsigned)-1) > NodeMaxCount) {
+            DEBUG_ONLY(Log::Put("Hierarchy is full, %016llx not linked\n", id.batch_id);)
+            return;
+        }
+        if (parent_index == (unsigned)-1)
+            parent_index = Add(parent_id, *parent_instance);
+        if (index == (unsigned)-1)
+            index = Add(id, *instance);
+        nodes.parents[index] = (uint16)parent_index;
+        SetWorld(index, instance->rotation, instance->position);
+        sorted = false;
+    }
+
+    void Remove(const Id& id) {
+        const unsigned index = Find(id);
+        if (index == (unsigned)-1)
+            return;
+        const auto key_at = [&](unsigned i) { return IdAt(i); };
+        table->Remove(id, key_at);
+        const unsigned last = --count;
+        for (unsigned i = 0; i < count + 1; ++i) {
+            if (nodes.parents[i] == index) // Orphans keep their world transform.
+                Unparent(i);
+        }
+        if (index != last) {
+            table->Move(nodes.ids[last], index, key_at);
+            nodes.ids[index] = nodes.ids[last];
+            nodes.parents[index] = nodes.parents[last];
+            nodes.dirty[index] = nodes.dirty[last];
+            nodes.local_rotations[index] = nodes.local_rotations[last];
+            nodes.local_positions[index] = nodes.local_positions[last];
+            nodes.world_rotations[index] = nodes.world_rotations[last];
+            nodes.world_positions[index] = nodes.world_positions[last];
+            for (unsigned i = 0; i < count; ++i)
+                if (nodes.parents[i] == last)
+                    nodes.parents[i] = (uint16)index;
+        }
+        sorted = false;
+    }
+
+    bool IsEmpty() const { return count == 0; }
+
+    void Sync(const Id& id, const Instance& instance) { // Instance moved outside the hierarchy, its local transform is solved from the new world one.
+        const unsigned index = Find(id);
+        if (index == (unsigned)-1)
+            return;
+        SetWorld(index, instance.rotation, instance.position);
+        nodes.dirty[index] = 1;
+    }
+
+    bool SetLocalPosition(const Id& id, const Vector3& position) {
+        const unsigned index = Find(id);
+        if (index == (unsigned)-1)
+            return false;
+        nodes.local_positions[index] = position;
+        nodes.dirty[index] = 1;
+        return true;
+    }
+
+    bool SetLocalRotation(const Id& id, const Quaternion& rotation) {
+        const unsigned index = Find(id);
+        if (index == (unsigned)-1)
+            return false;
+        nodes.local_rotations[index] = rotation;
+        nodes.dirty[index] = 1;
+        return true;
+    }
+
+    // Recomputes world transforms of dirty subtrees and writes them back to their instances.
+    template<typename F> void Update(F write_instance) {
+        if (!sorted)
+            Sort();
+        const unsigned root_count = level_count > 0 ? nodes.offsets[0] : 0;
+        for (unsigned i = 0; i < root_count; ++i) {
+            const unsigned index = nodes.order[i];
+            if (nodes.dirty[index]) {
+                nodes.world_rotations[index] = nodes.local_rotations[index];
+                nodes.world_positions[index] = nodes.local_positions[index];
+            }
+        }
+        for (unsigned level = 1; level < level_count; ++level)
+            UpdateLevel(nodes.offsets[level - 1], nodes.offsets[level]);
+        for (unsigned i = 0; i < count; ++i) {
+            if (nodes.dirty[i]) {
+                write_instance(nodes.ids[i], nodes.world_rotations[i], nodes.world_positions[i]);
+                nodes.dirty[i] = 0;
+            }
+        }
+    }
+};
+
+struct DrawRecord {
+    RenderClusterDynamic* render_cluster = nullptr; // Null for single draws.
+    CameraClusterDynamic* self_camera_cluster = nullptr;
+    ShaderDynamic* shader = nullptr;
+    unsigned technique_index = 0;
+    Array<SurfaceDynamic*, Camera::SurfaceMaxCount> surfaces;
+    MeshDynamic* mesh = nullptr;
+    Uniforms* uniforms = nullptr;
+    const Batch* batch = nullptr;
+    SpawnBatch* spawned = nullptr;
+};
+
+class DrawList : public NoCopy { // Records resolved per (camera, pass), rebuilt when bindings are swapped.
+public:
+    struct Range {
+        unsigned begin = 0;
+        unsigned end = 0;
+    };
+
+private:
+    Arena arena;
+    Range* ranges = nullptr;
+    DrawRecord* records = nullptr;
+    unsigned range_count = 0;
+    unsigned record_count = 0;
+    bool dirty = true;
+
+public:
+    void Reset(unsigned range_count, unsigned record_count) {
+        arena.~Arena();
+        new(&arena) Arena(Arena::AlignSize(range_count * sizeof(Range)) + Arena::AlignSize(record_count * sizeof(DrawRecord)), Memory::Tag::Draw);
+        ranges = (Range*)arena.Allocate(range_count * sizeof(Range));
+        records = (DrawRecord*)arena.Allocate(record_count * sizeof(DrawRecord));
+        this->range_count = range_count;
+        this->record_count = record_count;
+        dirty = false;
+    }
+
+    void Invalidate() { dirty = true; }
+    bool IsDirty() const { return dirty; }
+
+    Range& GetRange(unsigned index) {
+        DEBUG_ONLY(if (index >= range_count) throw Exception("Out-of-bounds");)
+        return ranges[index];
+    }
+
+    DrawRecord& GetRecord(unsigned index) {
+        DEBUG_ONLY(if (index >= record_count) throw Exception("Out-of-bounds");)
+        return records[index];
+    }
+
+    template<typename F> void ProcessRange(const Range& range, F func) {
+        for (unsigned i = range.begin; i < range.end; ++i) {
+            func(records[i]);
+        }
+    }
+};
+
+class ClusterSets : public NoCopy { // Bit sets over render clusters, 64 clusters per word.
+    Arena arena;
+    uint64* words = nullptr;
+    unsigned set_count = 0;
+    unsigned word_count = 0;
+
+    uint64* Words(unsigned set) const {
+        DEBUG_ONLY(if (set >= set_count) throw Exception("Out-of-bounds");)
+        return words + set * word_count;
+    }
+
+public:
+    void Reset(unsigned set_count, unsigned cluster_count) {
+        this->set_count = set_count;
+        word_count = (cluster_count + 63) / 64;
+        arena.~Arena();
+        new(&arena) Arena(Arena::AlignSize(Math::Max(set_count * word_count, 1u) * sizeof(uint64)), Memory::Tag::Draw);
+        words = (uint64*)arena.Allocate(set_count * word_count * sizeof(uint64));
+    }
+
+    unsigned SetCount() const { return set_count; }
+
+    void Clear(unsigned set) { memset(Words(set), 0, word_count * sizeof(uint64)); }
+    void Copy(unsigned set, unsigned from) { memcpy(Words(set), Words(from), word_count * sizeof(uint64)); }
+
+    void Add(unsigned set, unsigned index) { Words(set)[index / 64] |= (uint64)1 << (index % 64); }
+    void Remove(unsigned set, unsigned index) { Words(set)[index / 64] &= ~((uint64)1 << (index % 64)); }
+    bool Contains(unsigned set, unsigned index) const { return (Words(set)[index / 64] >> (index % 64)) & 1; }
+
+    template<typename F> void Process(unsigned set, F func) const {
+        const uint64* set_words = Words(set);
+        for (unsigned i = 0; i < word_count; ++i) {
+            for (uint64 word = set_words[i]; word != 0; word &= word - 1)
+                func(i * 64 + Math::TrailingZeros(word));
+        }
+    }
+};
+
+class ClusterTree : public NoCopy { // Bounding volume hierarchy over render clusters, built with SAH at load and refit as clusters move.
+    static const unsigned BinCount = 8;
+    static const unsigned SahDepthMaxCount = 24; // Deeper nodes split at the median to bound the traversal stack.
+    static const unsigned StackMaxCount = 64;
+    static const uint32 NoNode = (uint32)-1;
+
+    struct Node {
+        Aabb box;
+        uint32 parent = NoNode;
+        uint32 left = NoNode;
+        uint32 right = NoNode;
+        uint32 leaf = NoNode; // Leaf index, only set on leaves.
+    };
+
+    Arena arena;
+    Node* nodes = nullptr;
+    uint32* leaf_nodes = nullptr;
+    uint32* order = nullptr;
+    Aabb* boxes = nullptr;
+    unsigned leaf_count = 0;
+    unsigned node_count = 0;
+
+    static float Component(const Vector3& v, unsigned axis) { return (&v.x)[axis]; }
+
+    unsigned Partition(unsigned begin, unsigned end, unsigned depth) { // Binned SAH split along the widest centroid axis.
+        Aabb centroids;
+        for (unsigned i = begin; i < end; ++i) {
+            const auto center = boxes[order[i]].Center();
+            centroids = centroids.Merge(Aabb(center, center));
+        }
+        const auto extent = centroids.max - centroids.min;
+        const unsigned axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+        const float axis_min = Component(centroids.min, axis);
+        const float axis_extent = Component(extent, axis);
+        const unsigned middle = (begin + end) / 2;
+        if (depth >= SahDepthMaxCount || axis_extent <= 0.f)
+            return middle;
+
+        auto bin_of = [&](uint32 leaf) {
+            const float offset = Component(boxes[leaf].Center(), axis) - axis_min;
+            return Math::Min((unsigned)(BinCount * offset / axis_extent), BinCount - 1);
+        };
+
+        Aabb bin_boxes[BinCount];
+        unsigned bin_counts[BinCount] = {};
+        for (unsigned i = begin; i < end; ++i) {
+            const unsigned bin = bin_of(order[i]);
+            bin_boxes[bin] = bin_boxes[bin].Merge(boxes[order[i]]);
+            bin_counts[bin]++;
+        }
+
+        float right_costs[BinCount] = {};
+        Aabb right_box;
+        unsigned right_count = 0;
+        for (unsigned bin = BinCount - 1; bin > 0; --bin) {
+            right_box = right_box.Merge(bin_boxes[bin]);
+            right_count += bin_counts[bin];
+            right_costs[bin] = right_box.HalfArea() * right_count;
+        }
+
+        unsigned best_bin = 0;
+        float best_cost = Math::Large;
+        Aabb left_box;
+        unsigned left_count = 0;
+        for (unsigned bin = 1; bin < BinCount; ++bin) {
+            left_box = left_box.Merge(bin_boxes[bin - 1]);
+            left_count += bin_counts[bin - 1];
+            const float cost = left_box.HalfArea() * left_count + right_costs[bin];
+            if (left_count > 0 && left_count < end - begin && cost < best_cost) {
+                best_cost = cost;
+                best_bin = bin;
+            }
+        }
+        if (best_bin == 0)
+            return middle;
+
+        unsigned split = begin;
+        for (unsigned i = begin; i < end; ++i) {
+            if (bin_of(order[i]) < best_bin) {
+                const uint32 leaf = order[i];
+                order[i] = order[split];
+                order[split++] = leaf;
+            }
+        }
+        return split;
+    }
+
+    uint32 BuildNode(unsigned begin, unsigned end, uint32 parent, unsigned depth) {
+        const uint32 index = node_count++;
+        auto& node = nodes[index];
+        node = Node();
+        node.parent = parent;
+        if (end - begin == 1) {
+            node.leaf = order[begin];
+            node.box = boxes[node.leaf];
+            leaf_nodes[node.leaf] = index;
+            return index;
+        }
+        const unsigned split = Partition(begin, end, depth);
+        node.left = BuildNode(begin, split, index, depth + 1);
+        node.right = BuildNode(split, end, index, depth + 1);
+        node.box = nodes[node.left].box.Merge(nodes[node.right].box);
+        return index;
+    }
+
+public:
+    template<typename F> void Build(unsigned count, F get_box) {
+        arena.~Arena();
+        new(&arena) Arena(Arena::AlignSize(2 * count * sizeof(Node)) + Arena::AlignSize(count * sizeof(uint32)) * 2 + Arena::AlignSize(count * sizeof(Aabb)), Memory::Tag::Tree);
+        nodes = (Node*)arena.Allocate(2 * count * sizeof(Node));
+        leaf_nodes = (uint32*)arena.Allocate(count * sizeof(uint32));
+        order = (uint32*)arena.Allocate(count * sizeof(uint32));
+        boxes = (Aabb*)arena.Allocate(count * sizeof(Aabb));
+        leaf_count = count;
+        node_count = 0;
+        for (unsigned i = 0; i < count; ++i) {
+            order[i] = i;
+            boxes[i] = get_box(i);
+        }
+        if (count > 0)
+            BuildNode(0, count, NoNode, 0);
+    }
+
+    void Refit(unsigned leaf, const Aabb& box) { // Walks up until a parent box stops changing.
+        DEBUG_ONLY(if (leaf >= leaf_count) throw Exception("Out-of-bounds");)
+        uint32 index = leaf_nodes[leaf];
+        nodes[index].box = box;
+        for (index = nodes[index].parent; index != NoNode; index = nodes[index].parent) {
+            const auto merged = nodes[nodes[index].left].box.Merge(nodes[nodes[index].right].box);
+            if (merged == nodes[index].box)
+                break;
+            nodes[index].box = merged;
+        }
+    }
+
+    // Calls func with the index of every leaf whose box intersects volume (Aabb, Sphere or Ray).
+    template<typename V, typename F> void Query(const V& volume, F func) const {
+        if (node_count == 0)
+            return;
+        uint32 stack[StackMaxCount];
+        unsigned stack_count = 0;
+        stack[stack_count++] = 0;
+        while (stack_count > 0) {
+            const auto& node = nodes[stack[--stack_count]];
+            if (!node.box.Intersect(volume))
+                continue;
+            if (node.leaf != NoNode) {
+                func(node.leaf);
+                continue;
+            }
+            DEBUG_ONLY(if (stack_count + 2 > StackMaxCount) throw Exception("Cluster tree too deep");)
+            stack[stack_count++] = node.right;
+            stack[stack_count++] = node.left;
+        }
+    }
+
+    // Walks the tree once for a packet of rays, func gets the leaf and the lanes reaching it.
+    template<typename F> void Query(const RayLanes& rays, F func) const {
+        if (node_count == 0)
+            return;
+        uint32 stack[StackMaxCount];
+        unsigned stack_count = 0;
+        stack[stack_count++] = 0;
+        while (stack_count > 0) {
+            const auto& node = nodes[stack[--stack_count]];
+            const unsigned mask = rays.Intersect(node.box);
+            if (mask == 0)
+                continue;
+            if (node.leaf != NoNode) {
+                func(node.leaf, mask);
+                continue;
+            }
+            DEBUG_ONLY(if (stack_count + 2 > StackMaxCount) throw Exception("Cluster tree too deep");)
+            stack[stack_count++] = node.right;
+            stack[stack_count++] = node.left;
+        }
+    }
+};
+
+class Broadphase : public NoCopy { // Sweep and prune along x over instance boxes, re-sorted incrementally as they move.
+public:
+    static const unsigned ProxyMinCount = 256;
+    static const uint32 NoProxy = (uint32)-1;
+
+private:
+    struct Proxies { // Structure of arrays indexed by proxy, walked through the sorted order.
+        Aabb* boxes = nullptr;
+        Id* ids = nullptr;
+        Quaternion* rotations = nullptr;
+        Vector3* positions = nullptr;
+        Vector3* extents = nullptr;
+        uint32* order = nullptr; // Sorted on box min x, removed proxies linger until the next sort.
+        uint32* free = nullptr;
+        uint8* live = nullptr;
+    };
+
+    Proxies proxies;
+    unsigned capacity = 0;
+    unsigned order_count = 0;
+    unsigned used_count = 0;
+    unsigned free_count = 0;
+    bool sorted = true;
+
+    template<typename T> void Resize(T*& values, unsigned new_capacity) {
+        auto* new_values = (T*)Memory::Allocate(new_capacity * sizeof(T), Memory::Tag::Overlap);
+        if (used_count > 0)
+            memcpy((void*)new_values, values, used_count * sizeof(T));
+        Memory::Deallocate(values, capacity * sizeof(T), Memory::Tag::Overlap);
+        values = new_values;
+    }
+
+    template<typename F> void ProcessArrays(F func) {
+        func(proxies.boxes);
+        func(proxies.ids);
+        func(proxies.rotations);
+        func(proxies.positions);
+        func(proxies.extents);
+        func(proxies.order);
+        func(proxies.free);
+        func(proxies.live);
+    }
+
+    bool Overlap(uint32 proxy, const Box& box, const Quaternion& rotation, const Vector3& position) const {
+        return box.Overlap(rotation, position, Box(proxies.extents[proxy]), proxies.rotations[proxy], proxies.positions[proxy]);
+    }
+
+public:
+    ~Broadphase() {
+        ProcessArrays([&](auto*& values) {
+            Memory::Deallocate(values, capacity * sizeof(*values), Memory::Tag::Overlap);
+        });
+    }
+
+    void Reserve(unsigned count) { // Proxy indices stay valid when the arrays grow.
+        if (count <= capacity)
+            return;
+        ProcessArrays([&](auto*& values) {
+            Resize(values, count);
+        });
+        capacity = count;
+    }
+
+    uint32 Add(const Id& id, const Instance& instance, const Vector3& extents) {
+        uint32 proxy = NoProxy;
+        if (free_count > 0)
+            proxy = proxies.free[--free_count];
+        else {
+            if (used_count == capacity)
+                Reserve(capacity > 0 ? capacity * 2 : ProxyMinCount);
+            proxy = used_count++;
+        }
+        proxies.ids[proxy] = id;
+        proxies.extents[proxy] = extents;
+        proxies.live[proxy] = 1;
+        proxies.order[order_count++] = proxy;
+        Move(proxy, instance);
+        return proxy;
+    }
+
+    void Move(uint32 proxy, const Instance& instance) {
+        const auto half = Box(proxies.extents[proxy]).Enclose(instance.rotation);
+        proxies.boxes[proxy] = Aabb(instance.position - half, instance.position + half);
+        proxies.rotations[proxy] = instance.rotation;
+        proxies.positions[proxy] = instance.position;
+        sorted = false;
+    }
+
+    void Remove(uint32 proxy) { // Freed on the next sort so that the order never holds a proxy twice.
+        proxies.live[proxy] = 0;
+        sorted = false;
+    }
+
+    void Sort() { // Insertion sort, cheap since boxes move little between frames.
+        if (sorted)
+            return;
+        unsigned kept = 0;
+        for (unsigned i = 0; i < order_count; ++i) {
+            const uint32 proxy = proxies.order[i];
+            if (proxies.live[proxy])
+                proxies.order[kept++] = proxy;
+            else
+                proxies.free[free_count++] = proxy;
+        }
+        order_count = kept;
+        for (unsigned i = 1; i < order_count; ++i) {
+            const uint32 proxy = proxies.order[i];
+            const float min_x = proxies.boxes[proxy].min.x;
+            unsigned j = i;
+            for (; j > 0 && proxies.boxes[proxies.order[j - 1]].min.x > min_x; --j)
+                proxies.order[j] = proxies.order[j - 1];
+            proxies.order[j] = proxy;
+        }
+        sorted = true;
+    }
+
+    template<typename F> void ProcessPairs(F func) const {
+        DEBUG_ONLY(if (!sorted) throw Exception("Broadphase not sorted");)
+        for (unsigned i = 0; i < order_count; ++i) {
+            const uint32 a = proxies.order[i];
+            for (unsigned j = i + 1; j < order_count; ++j) {
+                const uint32 b = proxies.order[j];
+                if (proxies.boxes[b].min.x > proxies.boxes[a].max.x)
+                    break;
+                if (proxies.boxes[a].Intersect(proxies.boxes[b]) && Overlap(a, Box(proxies.extents[b]), proxies.rotations[b], proxies.positions[b]))
+                    func(proxies.ids[a], proxies.ids[b]);
+            }
+        }
+    }
+
+    template<typename F> void Query(const Box& box, const Quaternion& rotation, const Vector3& position, F func) const {
+        DEBUG_ONLY(if (!sorted) throw Exception("Broadphase not sorted");)
+        const auto half = box.Enclose(rotation);
+        const Aabb region(position - half, position + half);
+        for (unsigned i = 0; i < order_count; ++i) {
+            const uint32 proxy = proxies.order[i];
+            if (proxies.boxes[proxy].min.x > region.max.x)
+                break;
+            if (proxies.boxes[proxy].Intersect(region) && Overlap(proxy, box, rotation, position))
+                func(proxies.ids[proxy]);
+        }
+    }
+};
+
+class Telemetry : public NoCopy {
+    FixedArray<Histogram, (unsigned)Metric::Count> histograms;
+
+    static const char* MetricName(Metric metric) {
+        switch (metric) {
+        case Metric::CPUFrame: return "cpu_frame";
+        case Metric::GPUFrame: return "gpu_frame";
+        case Metric::Control: return "control";
+        case Metric::Audio: return "audio";
+        case Metric::Render: return "render";
+        default: return "unknown";
+        }
+    }
+
+public:
+    static const String Name() { return "telemetry.txt"; }
+
+    void Add(Metric metric, uint64 duration) {
+        histograms[(unsigned)metric].Add(duration);
+    }
+
+    Percentiles Get(Metric metric) const {
+        Percentiles percentiles;
+        if (metric < Metric::Count) {
+            const auto& histogram = histograms[(unsigned)metric];
+            percentiles.max = histogram.Max();
+            percentiles.p50 = Math::Min(histogram.Percentile(50.f), percentiles.max);
+            percentiles.p95 = Math::Min(histogram.Percentile(95.f), percentiles.max);
+            percentiles.p99 = Math::Min(histogram.Percentile(99.f), percentiles.max);
+        }
+        return percentiles;
+    }
+
+    void Write(const String& filename) const {
+        LongString text;
+        for (unsigned i = 0; i < (unsigned)Metric::Count; ++i) {
+            const auto percentiles = Get((Metric)i);
+            char line[String::MaxSize];
+            Text::Format(line, String::MaxSize, "%s: count=%u p50=%lluus p95=%lluus p99=%lluus max=%lluus\n", MetricName((Metric)i), histograms[i].Count(),
+                percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max);
+            text = text + LongString(line);
+        }
+        WriteOnlyFile file(filename, text.Size());
+        memcpy(file.Pointer(), text.Data(), text.Size());
+    }
+};
+
+class MemoryReport : public NoCopy {
+    static const unsigned LineMaxCount = Memory::OwnerMaxCount + (unsigned)Memory::Tag::Count + (unsigned)Data::Type::Count + 8;
+
+    char* buffer = nullptr;
+    size max_size = LineMaxCount * 128;
+    size used = 0;
+
+    void Append(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        const int count = vsnprintf(buffer + used, max_size - used, format, args);
+        va_end(args);
+        if (count > 0)
+            used = Math::Min(used + count, max_size - 1);
+    }
+
+public:
+    static const String Name() { return "memory.txt"; }
+
+    MemoryReport(const Bundle& bundle) {
+        buffer = (char*)Memory::Malloc(max_size);
+        Memory::ProcessCounters([&](auto tag, const auto& counter) {
+            Append("tag %s: current=%lld peak=%lld count=%lld\n", Memory::TagName(tag), counter.current, counter.peak, counter.count);
+        });
+        Append("bundle: mapped=%llu resident=%llu arena=%llu\n", (uint64)bundle.MappedSize(), (uint64)bundle.ResidentSize(), (uint64)bundle.ArenaSize());
+        FixedArray<int64, (unsigned)Data::Type::Count> type_sizes;
+        for (unsigned i = 0; i < (unsigned)Data::Type::Count; ++i)
+            type_sizes[i] = 0;
+        Memory::ProcessOwners([&](uint64 owner, int64 current) {
+            const auto data_type = Data::DataTypeFromId(owner);
+            if (data_type < Data::Type::Count)
+                type_sizes[(unsigned)data_type] += current;
+        });
+        for (unsigned i = 0; i < (unsigned)Data::Type::Count; ++i)
+            if (type_sizes[i] != 0)
+                Append("type %s: current=%lld\n", Data::TypeName((Data::Type)i), type_sizes[i]);
+        Memory::ProcessOwners([&](uint64 owner, int64 current) {
+            const char* name = bundle.FindName(owner);
+            Append("owner %016llx %s: current=%lld\n", owner, name ? name : "", current);
+        });
+    }
+
+    ~MemoryReport() {
+        Memory::Free(buffer, max_size);
+    }
+
+    void Write(const String& filename) const {
+        WriteOnlyFile file(filename, used);
+        memcpy(file.Pointer(), buffer, used);
+    }
+};
+
 class Common {
 protected:
     Profile profile;
     Timer timer;
     BundleDynamic bundle;
+    Spawns spawns;
+    Hierarchy hierarchy;
+    Telemetry telemetry;
 
     Common() {}
 };
@@ -183,20 +1211,14 @@ class Audio : public Common {
     Surround surround;
 
     void LoadAll() {
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Bank: ((BankDynamic&)data).Load(bundle, surround); break;
-            default: break;
-            }
+        bundle.ProcessType<Data::Type::Bank>([&](auto& data) {
+            ((BankDynamic&)data).Load(bundle, surround);
         });
     }
 
     void UnloadAll() {
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Bank: ((BankDynamic&)data).~BankDynamic(); break;
-            default: break;
-            }
+        bundle.ProcessType<Data::Type::Bank>([&](auto& data) {
+            ((BankDynamic&)data).~BankDynamic();
         });
     }
 
@@ -219,9 +1241,8 @@ protected:
     }
 
     void Update() {
-        DEBUG_ONLY(profile.BeginCPU(timer.Now(), Color::Yellow);)
+        PROFILE_ZONE("Audio", Color::Yellow);
         GarbageCollect();
-        DEBUG_ONLY(profile.EndCPU(timer.Now());)
     }
 
     bool Play(const Id& id, uint32 sound_id, float volume) {
@@ -238,43 +1259,81 @@ protected:
 };
 
 class Render : public Audio {
+    static const unsigned OccluderMaxCount = 64;
+
+    struct Occluder {
+        RenderClusterDynamic* render_cluster = nullptr;
+        const Mesh* mesh = nullptr;
+        const uint8* mesh_mem = nullptr;
+        uint8* shared_edges = nullptr;
+        unsigned batch_index = 0;
+    };
+
     Context context;
     Stack stack;
     uint64 gpu_frame_duration = 0;
+    RenderStats stats;
+    const ShaderDynamic* last_shader = nullptr;
+    unsigned last_technique_index = (unsigned)-1;
+    DrawList draws;
+    ClusterTree cluster_tree;
+    Broadphase overlaps;
+    OcclusionBuffer occlusion;
+    Array<Occluder, OccluderMaxCount> occluders;
+    uint64 occluder_mask = 0; // Occluders in the buffer for the current camera, one bit each.
+    unsigned pass_visible_set = 0; // Visible set of the current pass, without the clusters its occluders hide.
+    ClusterSets visible_sets; // Camera bounds queries first, then per camera sets with occluded clusters removed.
+    ClusterSets pass_sets; // Render clusters whose flags match each pass, one set per draw list range.
     DEBUG_ONLY(DebugDraw debug_draw;)
     DEBUG_ONLY(DebugShapes debug_shapes;)
     DEBUG_ONLY(DebugProfile debug_profile;)
+    DEBUG_ONLY(RenderStats debug_stats;)
     DEBUG_ONLY(bool draw_bounds = false;)
     DEBUG_ONLY(bool draw_extents = false;)
 
     void LoadAll() {
+        DEBUG_ONLY(context.SetNames(bundle);)
         CommandList upload_command_list(context);
         upload_command_list.Reset(context);
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Cell: ((CellDynamic&)data).Load(bundle, context); break;
-            case Data::Type::Mesh: ((MeshDynamic&)data).Load(bundle, context, upload_command_list); break;
-            case Data::Type::Shader: ((ShaderDynamic&)data).Load(bundle, context); break;
-            case Data::Type::Surface: ((SurfaceDynamic&)data).Load(bundle, context, upload_command_list); ((SurfaceDynamic&)data).Create(context); break;
-            default: break;
-            }
+        bundle.ProcessType<Data::Type::Cell>([&](auto& data) {
+            ((CellDynamic&)data).Load(bundle, context);
+        });
+        bundle.ProcessType<Data::Type::Mesh>([&](auto& data) {
+            ((MeshDynamic&)data).Load(bundle, context, upload_command_list);
+        });
+        bundle.ProcessType<Data::Type::Shader>([&](auto& data) {
+            ((ShaderDynamic&)data).Load(bundle, context);
+        });
+        bundle.ProcessType<Data::Type::Surface>([&](auto& data) {
+            ((SurfaceDynamic&)data).Load(bundle, context, upload_command_list);
+            ((SurfaceDynamic&)data).Create(context);
         });
         upload_command_list.Close(context);
         Array<CommandList*, 16> command_lists;
         command_lists.Add(&upload_command_list);
         CommandList::Execute(context, command_lists);
         context.Stop();
+        BuildVisibleSets();
+        BuildDraws();
+        BuildClusterTree();
+        BuildOverlaps();
+        BuildOccluders();
     }
 
     void UnloadAll() {
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Cell: ((CellDynamic&)data).~CellDynamic(); break;
-            case Data::Type::Mesh: ((MeshDynamic*)&data)->~MeshDynamic(); break;
-            case Data::Type::Shader: ((ShaderDynamic*)&data)->~ShaderDynamic(); break;
-            case Data::Type::Surface: ((SurfaceDynamic*)&data)->Destroy(context); ((SurfaceDynamic&)data).~SurfaceDynamic(); break;
-            default: break;
-            }
+        ClearOccluders();
+        bundle.ProcessType<Data::Type::Cell>([&](auto& data) {
+            ((CellDynamic&)data).~CellDynamic();
+        });
+        bundle.ProcessType<Data::Type::Mesh>([&](auto& data) {
+            ((MeshDynamic*)&data)->~MeshDynamic();
+        });
+        bundle.ProcessType<Data::Type::Shader>([&](auto& data) {
+            ((ShaderDynamic*)&data)->~ShaderDynamic();
+        });
+        bundle.ProcessType<Data::Type::Surface>([&](auto& data) {
+            ((SurfaceDynamic*)&data)->Destroy(context);
+            ((SurfaceDynamic&)data).~SurfaceDynamic();
         });
     }
 
@@ -290,6 +1349,7 @@ class Render : public Audio {
     }
 
     void UpdateCameras() {
+        PROFILE_ZONE("Render::UpdateCameras", Color::Aqua);
         bundle.ProcessCameraClusters([&](auto& camera_cluster) {
             if (auto* camera = bundle.Find<Camera>(camera_cluster.camera_id)) {
 #if !defined(__APPLE__) // TODO: Remove.
@@ -299,13 +1359,37 @@ class Render : public Audio {
                     camera->Update(*camera_cluster.camera_uniforms_cpu, camera_cluster.cluster->Batches()[0].Instances()[0].position, camera_cluster.cluster->Batches()[0].Instances()[0].rotation, context.WindowWidth(), context.WindowHeight());
             }
         });
+        UpdateVisibleSets();
+    }
+
+    void UpdateVisibleSets() { // One query per camera bounds, cameras with the same bounds share the first result.
+        bundle.ProcessCameraClustersIndex([&](auto& camera_cluster, unsigned index) {
+            const auto& bounds = camera_cluster.cluster->Bounds();
+            camera_cluster.visible_set = index;
+            bundle.ProcessCameraClustersIndex([&](auto& other, unsigned other_index) {
+                if ((other_index < index) && (other.visible_set == other_index) && (camera_cluster.visible_set == index) &&
+                    (other.cluster->Bounds().center == bounds.center) && (other.cluster->Bounds().radius == bounds.radius))
+                    camera_cluster.visible_set = other_index;
+            });
+            if (camera_cluster.visible_set != index)
+                return;
+            visible_sets.Clear(index);
+            cluster_tree.Query(bounds, [&](unsigned render_index) {
+                visible_sets.Add(index, render_index);
+            });
+        });
     }
 
     void ProcessCameras() {
-        bundle.ProcessCameraClusters([&](auto& camera_cluster) {
+        PROFILE_ZONE("Render::ProcessCameras", Color::Navy);
+        bundle.ProcessCameraClustersIndex([&](auto& camera_cluster, unsigned index) {
             if (auto* camera = bundle.Find<Camera>(camera_cluster.camera_id)) {
+                stats.cameras++;
+                last_shader = nullptr;
+                last_technique_index = (unsigned)-1;
                 camera_cluster.command_list.Reset(context);
-                ProcessTargets(camera_cluster, *camera);
+                ResetOccluders(camera_cluster);
+                ProcessTargets(camera_cluster, *camera, index);
                 camera_cluster.timings.Query(camera_cluster.command_list);
                 camera_cluster.command_list.Close(context);
                 camera_cluster.timings.GatherBegin();
@@ -319,106 +1403,389 @@ class Render : public Audio {
         });
     }
 
-    void ProcessTargets(CameraClusterDynamic& camera_cluster, const Camera& camera) {
+    void ProcessTargets(CameraClusterDynamic& camera_cluster, const Camera& camera, unsigned index) {
+        unsigned range_index = camera_cluster.draw_range_begin;
         camera.Targets().ConstProcess([&](auto& target) {
+            stats.targets++;
             auto attachments = GatherAttachments(camera_cluster, target);
-            ProcessPasses(camera_cluster, target, attachments);
+            ProcessPasses(camera_cluster, target, attachments, range_index, index);
             if (target.last)
                 DrawDebugLast(camera_cluster);
         });
     }
 
-    void ProcessPasses(CameraClusterDynamic& camera_cluster, const Camera::Target& target, const Attachments& attachments) {
+    void ProcessPasses(CameraClusterDynamic& camera_cluster, const Camera::Target& target, const Attachments& attachments, unsigned& range_index, unsigned index) {
         target.passes.ConstProcess([&](auto& pass) {
+            stats.passes++;
+            const uint64 mask = PassOccluders(range_index);
+            if (mask != occluder_mask)
+                DrawOccluders(camera_cluster, index, mask);
             camera_cluster.timings.Push(camera_cluster.command_list);
-            if (pass.auto_shader_id) {
-                DrawSingle(camera_cluster, pass, attachments);
-            } else {
-                bundle.ProcessRenderClusters([&](auto& render_cluster) {
-                    auto* self_camera_cluster = render_cluster.has_camera ? bundle.FindCameraCluster(render_cluster.cluster->Id()) : nullptr;
-                    DrawCluster(camera_cluster, render_cluster, self_camera_cluster, pass, attachments);
-                });
-            }
+            DrawRecords(camera_cluster, draws.GetRange(range_index++), attachments);
             camera_cluster.timings.Push(camera_cluster.command_list);
         });
     }
 
-    void DrawSingle(CameraClusterDynamic& camera_cluster, const Camera::Pass& pass, const Attachments& attachments) {
-        if (auto* shader = bundle.Find<ShaderDynamic>(pass.auto_shader_id)) {
-            unsigned technique_index = shader->FindTechnique(pass.technique_id);
-            if (technique_index != (unsigned)-1) {
-                auto surfaces = GatherSurfaces(pass.auto_surface_ids);
-                if (auto* mesh = bundle.Find<MeshDynamic>(pass.auto_mesh_id))
-                    if (auto* uniforms = bundle.Find<Uniforms>(pass.auto_uniforms_id)) {
-                        SetShaderAndSurfaces(camera_cluster, nullptr, attachments, *shader, surfaces, technique_index);
-                        const auto gpu = FillOne(camera_cluster);
-                        SetMeshAndDraw(camera_cluster, *mesh, *uniforms, gpu, 1);
-                    }
+    void DrawRecords(CameraClusterDynamic& camera_cluster, const DrawList::Range& range, const Attachments& attachments) {
+        const RenderClusterDynamic* current = nullptr;
+        bool visible = false;
+        bool bound = false;
+        draws.ProcessRange(range, [&](auto& record) {
+            if (!record.render_cluster) {
+                DrawSingle(camera_cluster, record, attachments);
+                return;
+            }
+            if (record.render_cluster != current) {
+                current = record.render_cluster;
+                stats.clusters_tested++;
+                visible = visible_sets.Contains(pass_visible_set, record.render_cluster->render_index);
+                bound = false;
+                if (!visible)
+                    stats.clusters_culled++;
             }
+            if (visible)
+                DrawBatch(camera_cluster, record, attachments, bound);
+            if (record.spawned)
+                DrawSpawned(camera_cluster, record, attachments, bound);
+        });
+    }
+
+    void Bind(CameraClusterDynamic& camera_cluster, DrawRecord& record, const Attachments& attachments, bool& bound) {
+        if (!bound) {
+            SetShaderAndSurfaces(camera_cluster, record.self_camera_cluster, attachments, *record.shader, record.surfaces, record.technique_index);
+            bound = true;
         }
     }
 
-    void DrawCluster(CameraClusterDynamic& camera_cluster, RenderClusterDynamic& render_cluster, CameraClusterDynamic* self_camera_cluster, const Camera::Pass& pass, const Attachments& attachments) {
-        if (render_cluster.cluster->Bounds().Intersect(camera_cluster.cluster->Bounds())) {
-            if (auto* flags = bundle.Find<Flags>(render_cluster.flags_id))
-                if (flags->Check(pass.include_flags, pass.exclude_flags))
-                    if (auto* shader = bundle.Find<ShaderDynamic>(render_cluster.shader_id)) {
-                        unsigned technique_index = shader->FindTechnique(pass.technique_id);
-                        if (technique_index != (unsigned)-1) {
-                            auto surfaces = GatherSurfaces(render_cluster.surface_ids);
-                            SetShaderAndSurfaces(camera_cluster, self_camera_cluster, attachments, *shader, surfaces, technique_index);
-                            render_cluster.mesh_ids.ProcessIndex([&](auto& mesh_id, unsigned index) {
-                                if (auto* mesh = bundle.Find<MeshDynamic>(mesh_id))
-                                    if (auto* uniforms = bundle.Find<Uniforms>(render_cluster.uniforms_ids[index])) {
-                                        const auto& batch = render_cluster.cluster->Batches()[index];
-                                        const auto gpu = FillBatch(camera_cluster, batch);
-                                        SetMeshAndDraw(camera_cluster, *mesh, *uniforms, gpu, batch.Instances().UsedCount());
-                                    }
+    void DrawBatch(CameraClusterDynamic& camera_cluster, DrawRecord& record, const Attachments& attachments, bool& bound) {
+        const auto& batch = *record.batch;
+        const auto& bounds = camera_cluster.cluster->Bounds();
+        stats.batches_tested++;
+        if (!batch.BoundingBox().Intersect(bounds)) {
+            stats.batches_culled++;
+            return;
+        }
+        if (!occlusion.IsVisible(batch.BoundingBox())) {
+            stats.occlusion_culled++;
+            return;
+        }
+        unsigned count = 0;
+        const auto gpu = FillVisible(bounds, batch, batch.Instances().Values(), batch.Instances().UsedCount(), count);
+        if (count == 0)
+            return;
+        Bind(camera_cluster, record, attachments, bound);
+        SetMeshAndDraw(camera_cluster, *record.mesh, *record.uniforms, gpu, count);
+    }
+
+    void DrawSpawned(CameraClusterDynamic& camera_cluster, DrawRecord& record, const Attachments& attachments, bool& bound) {
+        const auto& instances = record.spawned->Instances();
+        if (instances.UsedCount() == 0)
+            return;
+        const auto& bounds = camera_cluster.cluster->Bounds();
+        stats.batches_tested++;
+        const auto& box = record.spawned->BoundingBox(*record.batch);
+        if (!box.Intersect(bounds)) {
+            stats.batches_culled++;
+            return;
+        }
+        if (!occlusion.IsVisible(box)) {
+            stats.occlusion_culled++;
+            return;
+        }
+        for (unsigned offset = 0; offset < instances.UsedCount(); offset += Batch::InstanceMaxCount) {
+            unsigned count = 0;
+            const auto gpu = FillVisible(bounds, *record.batch, instances.Values() + offset, Math::Min(instances.UsedCount() - offset, Batch::InstanceMaxCount), count);
+            if (count == 0)
+                continue;
+            Bind(camera_cluster, record, attachments, bound);
+            SetMeshAndDraw(camera_cluster, *record.mesh, *record.uniforms, gpu, count);
+        }
+    }
+
+    void DrawSingle(CameraClusterDynamic& camera_cluster, DrawRecord& record, const Attachments& attachments) {
+        SetShaderAndSurfaces(camera_cluster, nullptr, attachments, *record.shader, record.surfaces, record.technique_index);
+        const auto gpu = FillOne(camera_cluster);
+        SetMeshAndDraw(camera_cluster, *record.mesh, *record.uniforms, gpu, 1);
+    }
+
+    template<typename R, typename F> void ResolveDraws(R add_range, F add_record) {
+        unsigned range_index = 0;
+        bundle.ProcessCameraClusters([&](auto& camera_cluster) {
+            if (auto* camera = bundle.Find<Camera>(camera_cluster.camera_id)) {
+                camera_cluster.draw_range_begin = range_index;
+                camera->Targets().ConstProcess([&](auto& target) {
+                    target.passes.ConstProcess([&](auto& pass) {
+                        const unsigned pass_range = range_index++;
+                        add_range(pass_range);
+                        if (pass.auto_shader != InvalidDataHandle)
+                            ResolveSingle(pass, add_record);
+                        else
+                            pass_sets.Process(pass_range, [&](unsigned render_index) {
+                                ResolveCluster(bundle.GetRenderCluster(render_index), pass, add_record);
                             });
-                        }
-                    }
+                    });
+                });
+            }
+        });
+    }
+
+    template<typename F> void ResolveSingle(const Camera::Pass& pass, F add_record) {
+        DrawRecord record;
+        if ((record.shader = bundle.Get<ShaderDynamic>(pass.auto_shader))) {
+            record.technique_index = record.shader->FindTechnique(pass.technique_id);
+            if (record.technique_index != (unsigned)-1) {
+                record.surfaces = GatherSurfaces(pass.auto_surfaces);
+                record.mesh = bundle.Get<MeshDynamic>(pass.auto_mesh);
+                record.uniforms = bundle.Get<Uniforms>(pass.auto_uniforms);
+                if (record.mesh && record.uniforms)
+                    add_record(record);
+            }
+        }
+    }
+
+    template<typename F> void ResolveCluster(RenderClusterDynamic& render_cluster, const Camera::Pass& pass, F add_record) {
+        DrawRecord record;
+        record.render_cluster = &render_cluster;
+        record.self_camera_cluster = render_cluster.has_camera ? bundle.FindCameraCluster(render_cluster.cluster->Id()) : nullptr;
+        if ((record.shader = bundle.Get<ShaderDynamic>(render_cluster.shader))) {
+            record.technique_index = record.shader->FindTechnique(pass.technique_id);
+            if (record.technique_index != (unsigned)-1) {
+                record.surfaces = GatherSurfaces(render_cluster.surfaces);
+                render_cluster.meshes.ConstProcessIndex([&](auto& mesh_handle, unsigned index) {
+                    record.mesh = bundle.Get<MeshDynamic>(mesh_handle);
+                    record.uniforms = bundle.Get<Uniforms>(render_cluster.uniforms[index]);
+                    record.batch = &render_cluster.cluster->Batches()[index];
+                    record.spawned = spawns.Find(render_cluster.cluster->Id(), record.batch->Id());
+                    if (record.mesh && record.uniforms)
+                        add_record(record);
+                });
+            }
         }
     }
 
+    template<typename F> void ProcessPassRanges(F func) { // Same order as the draw list ranges.
+        unsigned range_index = 0;
+        bundle.ProcessCameraClusters([&](auto& camera_cluster) {
+            if (auto* camera = bundle.Find<Camera>(camera_cluster.camera_id))
+                camera->Targets().ConstProcess([&](auto& target) {
+                    target.passes.ConstProcess([&](auto& pass) {
+                        func(pass, range_index++);
+                    });
+                });
+        });
+    }
+
+    void BuildPassSets() { // Flags are static, they are only checked again when bindings are swapped.
+        unsigned pass_count = 0;
+        ProcessPassRanges([&](auto& pass, unsigned range_index) { pass_count++; });
+        pass_sets.Reset(pass_count, bundle.RenderClusterCount());
+        ProcessPassRanges([&](auto& pass, unsigned range_index) {
+            if (pass.auto_shader != InvalidDataHandle)
+                return;
+            bundle.ProcessRenderClustersIndex([&](auto& render_cluster, unsigned index) {
+                if (auto* flags = bundle.Get<Flags>(render_cluster.flags))
+                    if (flags->Check(pass.include_flags, pass.exclude_flags))
+                        pass_sets.Add(range_index, index);
+            });
+        });
+    }
+
+    void BuildDraws() {
+        PROFILE_ZONE("Render::BuildDraws", Color::Navy);
+        BuildPassSets();
+        unsigned range_count = 0;
+        unsigned record_count = 0;
+        ResolveDraws([&](unsigned range_index) { range_count++; }, [&](auto& record) { record_count++; });
+        draws.Reset(range_count, record_count);
+        DrawList::Range* range = nullptr;
+        unsigned record_index = 0;
+        ResolveDraws([&](unsigned range_index) {
+            range = &draws.GetRange(range_index);
+            range->begin = record_index;
+            range->end = record_index;
+        }, [&](auto& record) {
+            draws.GetRecord(record_index++) = record;
+            range->end = record_index;
+        });
+    }
+
+    void BuildClusterTree() {
+        PROFILE_ZONE("Render::BuildClusterTree", Color::Navy);
+        cluster_tree.Build(bundle.RenderClusterCount(), [&](unsigned index) {
+            auto& cluster = *bundle.GetRenderCluster(index).cluster;
+            if (cluster.IsDirty())
+                cluster.ComputeBounds();
+            return cluster.BoundingBox();
+        });
+    }
+
+    void BuildVisibleSets() {
+        bundle.ProcessRenderClustersIndex([&](auto& render_cluster, unsigned index) {
+            render_cluster.render_index = index;
+        });
+        visible_sets.Reset(2 * bundle.CameraClusterCount(), bundle.RenderClusterCount());
+    }
+
+    void ClearOccluders() {
+        occluders.ConstProcess([&](auto& occluder) {
+            Memory::Deallocate(occluder.shared_edges, occluder.mesh->TriangleCount(), Memory::Tag::Occlusion);
+        });
+        occluders.Clear();
+    }
+
+    void BuildOccluders() {
+        ClearOccluders();
+        bundle.ProcessRenderClusters([&](auto& render_cluster) {
+            render_cluster.meshes.ConstProcessIndex([&](auto& mesh_handle, unsigned index) {
+                const auto* mesh = bundle.Get<MeshDynamic>(mesh_handle);
+                if (!mesh || !mesh->IsOccluder() || occluders.IsFull())
+                    return;
+                auto& occluder = occluders.Add();
+                occluder.render_cluster = &render_cluster;
+                occluder.mesh = mesh;
+                occluder.mesh_mem = bundle.FindData(mesh->Id()).Mem();
+                occluder.shared_edges = (uint8*)Memory::Allocate(mesh->TriangleCount(), Memory::Tag::Occlusion);
+                OcclusionBuffer::FindSharedEdges(mesh->Triangles(occluder.mesh_mem), mesh->TriangleCount(), occluder.shared_edges);
+                occluder.batch_index = index;
+            });
+        });
+    }
+
+    uint64 PassOccluders(unsigned range_index) const { // Occluders the pass draws itself, single draw passes have none.
+        static_assert(OccluderMaxCount <= 64);
+        uint64 mask = 0;
+        occluders.ConstProcessIndex([&](auto& occluder, unsigned index) {
+            if (pass_sets.Contains(range_index, occluder.render_cluster->render_index))
+                mask |= (uint64)1 << index;
+        });
+        return mask;
+    }
+
+    void ResetOccluders(const CameraClusterDynamic& camera_cluster) {
+        occlusion.Begin(Matrix());
+        occluder_mask = 0;
+        pass_visible_set = camera_cluster.visible_set;
+    }
+
+    void DrawOccluders(CameraClusterDynamic& camera_cluster, unsigned index, uint64 mask) { // Rebuilt only when a pass draws a different set of occluders than the previous one.
+        PROFILE_ZONE("Render::DrawOccluders", Color::Navy);
+        occluder_mask = mask;
+        pass_visible_set = camera_cluster.visible_set;
+        occlusion.Begin(camera_cluster.camera_uniforms_cpu ? camera_cluster.camera_uniforms_cpu->viewproj : Matrix());
+        if (camera_cluster.camera_uniforms_cpu)
+            occluders.ConstProcessIndex([&](auto& occluder, unsigned occluder_index) {
+                if ((mask & ((uint64)1 << occluder_index)) == 0)
+                    return;
+                occluder.render_cluster->cluster->Batches()[occluder.batch_index].Instances().ConstProcess([&](auto& instance) {
+                    const Matrix world(Vector4(instance.rotation.Right(), 0.f), Vector4(instance.rotation.Up(), 0.f), Vector4(instance.rotation.At(), 0.f), Vector4(instance.position, 1.f));
+                    occlusion.Draw(occluder.mesh->Triangles(occluder.mesh_mem), occluder.shared_edges, occluder.mesh->TriangleCount(), world);
+                });
+            });
+        occlusion.End();
+        if (!occlusion.IsActive())
+            return;
+        const unsigned occluded_set = bundle.CameraClusterCount() + index; // Own set, the shared one stays intact for other cameras and passes.
+        visible_sets.Copy(occluded_set, camera_cluster.visible_set);
+        visible_sets.Process(camera_cluster.visible_set, [&](unsigned render_index) {
+            if (!occlusion.IsVisible(bundle.GetRenderCluster(render_index).cluster->BoundingBox())) {
+                visible_sets.Remove(occluded_set, render_index);
+                stats.occlusion_culled++;
+            }
+        });
+        pass_visible_set = occluded_set;
+    }
+
+    void BuildOverlaps() {
+        unsigned count = 0;
+        bundle.ProcessRenderClusters([&](auto& render_cluster) {
+            render_cluster.cluster->Batches().ConstProcess([&](auto& batch) {
+                count += batch.Instances().UsedCount();
+            });
+        });
+        overlaps.Reserve(count + Broadphase::ProxyMinCount); // Room for spawns before the first growth.
+        bundle.ProcessRenderClusters([&](auto& render_cluster) {
+            render_cluster.cluster->Batches().ConstProcessIndex([&](auto& batch, unsigned batch_index) {
+                render_cluster.proxy_begins[batch_index] = Broadphase::NoProxy;
+                batch.Instances().ConstProcessIndex([&](auto& instance, unsigned index) {
+                    const uint32 proxy = overlaps.Add(Id(render_cluster.cluster->Id(), batch.Id(), index), instance, batch.Extents());
+                    if (index == 0)
+                        render_cluster.proxy_begins[batch_index] = proxy;
+                });
+            });
+        });
+        overlaps.Sort();
+    }
+
+    void MoveOverlaps(RenderClusterDynamic& render_cluster) { // Before bounds are computed, while batches are still dirty.
+        render_cluster.cluster->Batches().ConstProcessIndex([&](auto& batch, unsigned batch_index) {
+            const uint32 proxy_begin = render_cluster.proxy_begins[batch_index];
+            if (batch.IsDirty() && proxy_begin != Broadphase::NoProxy)
+                batch.Instances().ConstProcessIndex([&](auto& instance, unsigned index) {
+                    overlaps.Move(proxy_begin + index, instance);
+                });
+        });
+    }
+
+    void MoveSpawnedOverlaps() {
+        spawns.Process([&](auto& spawned) {
+            spawned.MoveProxies([&](uint32 proxy, const Instance& instance) {
+                overlaps.Move(proxy, instance);
+            });
+        });
+    }
+
     void DrawDebugLast(CameraClusterDynamic& camera_cluster) {
         DEBUG_ONLY(debug_draw.Reset(camera_cluster.command_list);)
         DEBUG_ONLY(debug_draw.Begin(context);)
         DEBUG_ONLY(debug_shapes.Draw(debug_draw, camera_cluster.camera_uniforms_cpu->viewproj);)
-        DEBUG_ONLY(debug_profile.Draw(profile, debug_draw, context.WindowWidth(), context.WindowHeight());)
+        DEBUG_ONLY(debug_profile.Draw(profile, debug_stats, debug_draw, context.WindowWidth(), context.WindowHeight());)
     }
 
     Attachments GatherAttachments(CameraClusterDynamic& camera_cluster, const Camera::Target& target) {
         Array<SurfaceDynamic*, Camera::ColorAttachmentMaxCount > color_attachments;
         SurfaceDynamic* depth_stencil_attachment = nullptr;
-        target.color_attachment_ids.ConstProcess([&](auto& color_attachment_id) {
-            color_attachments.Add(bundle.Find<SurfaceDynamic>(color_attachment_id));
+        target.color_attachments.ConstProcess([&](auto& color_attachment) {
+            color_attachments.Add(bundle.Get<SurfaceDynamic>(color_attachment));
         });
-        depth_stencil_attachment = bundle.Find<SurfaceDynamic>(target.depth_stencil_attachment_id);
+        depth_stencil_attachment = bundle.Get<SurfaceDynamic>(target.depth_stencil_attachment);
         return Attachments(context, camera_cluster.command_list, color_attachments, depth_stencil_attachment, target.clear_color, target.clear_depth, target.last);
     }
 
-    Array<SurfaceDynamic*, Camera::SurfaceMaxCount> GatherSurfaces(const Array<uint64, Camera::SurfaceMaxCount>& surface_ids) {
+    Array<SurfaceDynamic*, Camera::SurfaceMaxCount> GatherSurfaces(const Array<DataHandle, Camera::SurfaceMaxCount>& surface_handles) {
         Array<SurfaceDynamic*, Camera::SurfaceMaxCount> surfaces;
-        surface_ids.ConstProcessIndex([&](auto& surface_id, unsigned index) {
-            surfaces.Add(bundle.Find<SurfaceDynamic>(surface_id));
+        surface_handles.ConstProcessIndex([&](auto& surface_handle, unsigned index) {
+            surfaces.Add(bundle.Get<SurfaceDynamic>(surface_handle));
         });
         return surfaces;
     }
 
     void SetShaderAndSurfaces(CameraClusterDynamic& camera_cluster, CameraClusterDynamic* self_camera_cluster, const Attachments& attachments, ShaderDynamic& shader, Array<SurfaceDynamic*, Camera::SurfaceMaxCount>& surfaces, unsigned technique_index) {
+        if ((&shader != last_shader) || (technique_index != last_technique_index)) {
+            stats.shader_switches++;
+            last_shader = &shader;
+            last_technique_index = technique_index;
+        }
         shader.Set(camera_cluster.command_list, technique_index);
         SurfaceDynamic::Set(context, camera_cluster.command_list, surfaces);
+        stats.surface_binds++;
         ShaderDynamic::SetCameraConstants(camera_cluster.command_list, camera_cluster.camera_uniforms_gpu);
-        if (self_camera_cluster)
+        stats.constant_updates++;
+        if (self_camera_cluster) {
             ShaderDynamic::SetBatchCameraConstants(camera_cluster.command_list, self_camera_cluster->camera_uniforms_gpu);
+            stats.constant_updates++;
+        }
         const auto gpu = FillMisc(attachments);
         ShaderDynamic::SetMiscConstants(camera_cluster.command_list, gpu);
+        stats.constant_updates++;
     }
 
     void SetMeshAndDraw(CameraClusterDynamic& camera_cluster, MeshDynamic& mesh, Uniforms& uniforms, uint64 gpu, unsigned instance_count) {
         ShaderDynamic::SetBatchInstanceConstants(camera_cluster.command_list, gpu);
         ShaderDynamic::SetUniformsConstants(camera_cluster.command_list, uniforms.Values());
+        stats.constant_updates += 2;
         mesh.SetAndDraw(camera_cluster.command_list, instance_count);
+        stats.draws++;
+        stats.instances += instance_count;
     }
 
     struct MiscUniforms {
@@ -453,15 +1820,23 @@ class Render : public Audio {
         return gpu;
     }
 
-    uint64 FillBatch(CameraClusterDynamic& camera_cluster, const Batch& batch) {
+    uint64 FillVisible(const Sphere& bounds, const Batch& batch, const Instance* instances, unsigned count, unsigned& out_count) { // Packs the instances whose box reaches the camera bounds.
         uint64 gpu = 0;
+        out_count = count;
 #if !defined(__APPLE__) // TODO: Remove.
-        Instances* cpu = nullptr;
-        stack.Allocate(sizeof(Instances), (uint8*&)cpu, gpu);
-        batch.Instances().ConstProcessIndex([&](auto& instance, unsigned index) {
-            (*cpu)[index] = instance;
-        });
+        uint8 visible[Batch::InstanceMaxCount]; // Culled first so that a fully culled batch takes no upload block.
+        out_count = 0;
+        for (unsigned i = 0; i < count; ++i)
+            if (batch.InstanceBox(instances[i]).Intersect(bounds))
+                visible[out_count++] = (uint8)i;
+        if (out_count > 0) {
+            Instances* cpu = nullptr;
+            stack.Allocate(sizeof(Instances), (uint8*&)cpu, gpu);
+            for (unsigned i = 0; i < out_count; ++i)
+                (*cpu)[i] = instances[visible[i]];
+        }
 #endif
+        stats.instances_culled += count - out_count;
         return gpu;
     }
 
@@ -492,6 +1867,7 @@ class Render : public Audio {
     };
 
     void Execute() {
+        PROFILE_ZONE("Render::Execute", Color::Teal);
         Array<SortedCameraCluster, 16> sorted_camera_clusters;
         bundle.ProcessCameraClusters([&](auto& camera_cluster) {
             if (auto* camera = bundle.Find<Camera>(camera_cluster.camera_id))
@@ -523,6 +1899,105 @@ class Render : public Audio {
         });
     }
 
+    static bool Intersect(Ray& ray, const Box& box, const Mesh* mesh, const uint8* mesh_mem, const Instance& instance) { // Box first, then the triangles when the mesh carries a tree.
+        if (!mesh_mem)
+            return box.Intersect(ray, instance.rotation, instance.position);
+        float t0, t1;
+        float t = ray.hit_fraction * ray.from.Distance(ray.to);
+        if (!box.Span(ray, instance.rotation, instance.position, t0, t1) || (t1 <= 0.f) || (t0 >= t))
+            return false;
+        const Vector3 from = instance.rotation.Transform(ray.from - instance.position); // Same instance space as the box test.
+        const Vector3 direction = instance.rotation.Transform(ray.direction);
+        if (mesh->Intersect(mesh_mem, from, direction, t))
+            return ray.ClosestHit(ray.from + ray.direction * t);
+        return false;
+    }
+
+    static unsigned CheckFlags(const Flags* cluster_flags, const unsigned* flags, unsigned count, unsigned mask) {
+        if (!cluster_flags)
+            return 0;
+        for (unsigned lane = 0; lane < count; ++lane)
+            if (!cluster_flags->Check(flags[lane], 0))
+                mask &= ~(1u << lane);
+        return mask;
+    }
+
+    template<typename I, typename F> static void CastInstances(RayLanes& lanes, Ray* rays, Id* out_ids, unsigned count, unsigned mask, const Batch& batch, const Mesh* mesh, const uint8* mesh_mem, const I& instances, F make_id) { // Lanes missing the instance box skip the exact test.
+        const Box box(batch.Extents());
+        instances.ConstProcessIndex([&](auto& instance, unsigned index) {
+            const unsigned instance_mask = mask & lanes.Intersect(batch.InstanceBox(instance));
+            if (!instance_mask)
+                return;
+            bool hit = false;
+            for (unsigned lane = 0; lane < count; ++lane) {
+                if ((instance_mask & (1u << lane)) && Intersect(rays[lane], box, mesh, mesh_mem, instance)) {
+                    out_ids[lane] = make_id(index);
+                    hit = true;
+                }
+            }
+            if (hit)
+                lanes.Clip(rays, count);
+        });
+    }
+
+    void CastPacket(Ray* rays, const unsigned* flags, Id* out_ids, unsigned count) { // Up to four rays share one walk down the cluster tree.
+        RayLanes lanes(rays, count);
+        cluster_tree.Query(lanes, [&](unsigned render_index, unsigned mask) {
+            auto& render_cluster = bundle.GetRenderCluster(render_index);
+            mask = CheckFlags(bundle.Get<Flags>(render_cluster.flags), flags, count, mask);
+            if (mask == 0)
+                return;
+            render_cluster.cluster->Batches().ProcessIndex([&](auto& batch, unsigned batch_index) {
+                const unsigned batch_mask = mask & lanes.Intersect(batch.BoundingBox());
+                if (!batch_mask)
+                    return;
+                const auto* mesh = batch_index < render_cluster.meshes.UsedCount() ? bundle.Get<MeshDynamic>(render_cluster.meshes[batch_index]) : nullptr;
+                const uint8* mesh_mem = mesh && mesh->HasTree() ? bundle.FindData(mesh->Id()).Mem() : nullptr;
+                CastInstances(lanes, rays, out_ids, count, batch_mask, batch, mesh, mesh_mem, batch.Instances(), [&](unsigned index) {
+                    return Id(render_cluster.cluster->Id(), batch.Id(), index);
+                });
+            });
+        });
+        spawns.Process([&](auto& spawned) { // Spawned instances are outside the cluster bounds, so they are tested against their own boxes.
+            auto* render_cluster = bundle.FindRenderCluster(spawned.ClusterId());
+            if (!render_cluster)
+                return;
+            unsigned batch_index = 0;
+            const auto* batch = render_cluster->cluster->ConstFindIndex(spawned.BatchId(), batch_index);
+            if (!batch)
+                return;
+            const unsigned mask = CheckFlags(bundle.Get<Flags>(render_cluster->flags), flags, count, (1u << count) - 1) & lanes.Intersect(spawned.BoundingBox(*batch));
+            if (mask == 0)
+                return;
+            const auto* mesh = batch_index < render_cluster->meshes.UsedCount() ? bundle.Get<MeshDynamic>(render_cluster->meshes[batch_index]) : nullptr;
+            const uint8* mesh_mem = mesh && mesh->HasTree() ? bundle.FindData(mesh->Id()).Mem() : nullptr;
+            CastInstances(lanes, rays, out_ids, count, mask, *batch, mesh, mesh_mem, spawned.Instances(), [&](unsigned index) {
+                return Id(spawned.ClusterId(), spawned.BatchId(), Id::SpawnedBit | spawned.Instances().Handle(index));
+            });
+        });
+    }
+
+    template<typename F> void CastAll(unsigned count, RayHit* out_hits, F build_ray) {
+        for (unsigned begin = 0; begin < count; begin += 4) {
+            const unsigned lane_count = Math::Min(count - begin, 4u);
+            Ray rays[4];
+            unsigned flags[4] = {};
+            Id ids[4];
+            for (unsigned lane = 0; lane < lane_count; ++lane)
+                build_ray(begin + lane, rays[lane], flags[lane]);
+            CastPacket(rays, flags, ids, lane_count);
+            for (unsigned lane = 0; lane < lane_count; ++lane) {
+                auto& hit = out_hits[begin + lane];
+                hit = RayHit();
+                if (ids[lane]) {
+                    hit.id = ids[lane];
+                    hit.position = rays[lane].hit_position;
+                    hit.distance = rays[lane].from.Distance(rays[lane].hit_position);
+                }
+            }
+        }
+    }
+
     Ray BuildRay(const Matrix& proj, const Matrix& view_inverse, float x, float y) const {
         const float px = (((2.f * x) / context.WindowWidth()) - 1.f) / proj.row0.x;
         const float py = (((-2.f * y) / context.WindowHeight()) + 1.f) / proj.row1.y;
@@ -546,37 +2021,97 @@ protected:
 
     void Update() {
         Swap();
-        DEBUG_ONLY(profile.BeginCPU(timer.Now(), Color::Blue);)
+        PROFILE_ZONE("Render", Color::Blue);
+        DEBUG_ONLY(debug_stats = stats;)
+        stats = RenderStats();
+        UpdateBounds();
         DEBUG_ONLY(Render::DrawDebug();)
         UpdateCameras();
+        if (draws.IsDirty())
+            BuildDraws();
         ProcessCameras();
         Time();
         Execute();
-        DEBUG_ONLY(profile.EndCPU(timer.Now());)
+        stats.stack_bytes = stack.Used();
+    }
+
+    void UpdateBounds() {
+        PROFILE_ZONE("Render::UpdateBounds", Color::Olive);
+        bundle.ProcessRenderClustersIndex([&](auto& render_cluster, unsigned index) {
+            if (render_cluster.cluster->IsDirty()) {
+                MoveOverlaps(render_cluster);
+                render_cluster.cluster->ComputeBounds();
+                cluster_tree.Refit(index, render_cluster.cluster->BoundingBox());
+            }
+        });
+        bundle.ProcessClusters([&](auto& cluster) {
+            if (cluster.IsDirty())
+                cluster.ComputeBounds();
+        });
+        MoveSpawnedOverlaps();
+        overlaps.Sort();
     }
 
     Id Pick(const Id& camera_id, float x, float y, unsigned _flags, Ray& out_ray) {
+        UpdateBounds();
         if (auto* camera_cluster = bundle.FindCameraCluster(camera_id.cluster_id)) {
             out_ray = BuildRay(camera_cluster->camera_uniforms_cpu->proj, camera_cluster->camera_uniforms_cpu->view_inverse, x, y);
             Id out_id;
-            bundle.ProcessRenderClusters([&](auto& render_cluster) {
-                if (auto* flags = bundle.Find<Flags>(render_cluster.flags_id)) {
-                    if (flags->Check(_flags, 0))
-                        if (render_cluster.cluster->Bounds().Intersect(out_ray))
-                            render_cluster.cluster->Batches().Process([&](auto& batch) {
-                            Box box(batch.Extents());
-                            batch.Instances().ProcessIndex([&](auto& instance, unsigned index) {
-                                if (box.Intersect(out_ray, batch.Instances()[index].rotation, batch.Instances()[index].position))
-                                    out_id = Id(render_cluster.cluster->Id(), batch.Id(), index);
-                            });
-                        });
-                }
-            });
+            CastPacket(&out_ray, &_flags, &out_id, 1);
             return out_id;
         }
         return Id();
     }
 
+    void CastRays(const RayQuery* queries, unsigned count, RayHit* out_hits) {
+        UpdateBounds();
+        CastAll(count, out_hits, [&](unsigned index, Ray& ray, unsigned& flags) {
+            ray = Ray(queries[index].from, queries[index].to);
+            flags = queries[index].flags;
+        });
+    }
+
+    void CastScreenRays(const Id& camera_id, const Vector2* points, unsigned count, unsigned _flags, RayHit* out_hits) {
+        UpdateBounds();
+        if (auto* camera_cluster = bundle.FindCameraCluster(camera_id.cluster_id)) {
+            const auto& uniforms = *camera_cluster->camera_uniforms_cpu;
+            CastAll(count, out_hits, [&](unsigned index, Ray& ray, unsigned& flags) {
+                ray = BuildRay(uniforms.proj, uniforms.view_inverse, points[index].x, points[index].y);
+                flags = _flags;
+            });
+        }
+        else {
+            for (unsigned i = 0; i < count; ++i)
+                out_hits[i] = RayHit();
+        }
+    }
+
+    unsigned OverlapPairs(OverlapPair* out_pairs, unsigned max_count) { // Returns the total count, like snprintf, so callers can tell when max_count cut results.
+        UpdateBounds();
+        unsigned count = 0;
+        overlaps.ProcessPairs([&](const Id& a, const Id& b) {
+            if (count < max_count)
+                out_pairs[count] = OverlapPair(a, b);
+            count++;
+        });
+        return count;
+    }
+
+    unsigned OverlapBox(const Vector3& position, const Quaternion& rotation, const Vector3& extents, Id* out_ids, unsigned max_count) {
+        UpdateBounds();
+        unsigned count = 0;
+        overlaps.Query(Box(extents), rotation, position, [&](const Id& id) {
+            if (count < max_count)
+                out_ids[count] = id;
+            count++;
+        });
+        return count;
+    }
+
+    unsigned OverlapAabb(const Vector3& min, const Vector3& max, Id* out_ids, unsigned max_count) {
+        return OverlapBox((min + max) * 0.5f, Quaternion(), (max - min) * 0.5f, out_ids, max_count);
+    }
+
     void DrawClusterBox(const Id& id) {
         bundle.ProcessRenderClusters([&](auto& render_cluster) {
             if (const auto* batch = render_cluster.cluster->ConstFind(id.batch_id)) {
@@ -588,8 +2123,10 @@ protected:
     void SwapSurface(const Id& id, unsigned index, uint64 texture_id) {
        const auto data_type = Data::DataTypeFromId(texture_id);
         if ((data_type == Data::Type::Surface) || (data_type == Data::Type::Surface)) {
-            if (auto* render_cluster = bundle.FindRenderCluster(id.cluster_id))
-                render_cluster->surface_ids[index] = texture_id;
+            if (auto* render_cluster = bundle.FindRenderCluster(id.cluster_id)) {
+                render_cluster->surfaces[index] = bundle.FindHandle(texture_id);
+                draws.Invalidate();
+            }
         }
     }
 
@@ -600,8 +2137,18 @@ protected:
                 cluster->Batches().ConstProcessIndex([&](auto& batch, unsigned batch_index) {
                     if (batch.Id() == id.batch_id)
                         if (auto* render_cluster = bundle.FindRenderCluster(id.cluster_id))
-                            render_cluster->uniforms_ids[batch_index] = uniforms_id;
+                            render_cluster->uniforms[batch_index] = bundle.FindHandle(uniforms_id);
                 });
+                draws.Invalidate();
+            }
+        }
+    }
+
+    void SwapFlags(const Id& id, uint64 flags_id) {
+        if (Data::DataTypeFromId(flags_id) == Data::Type::Flags) {
+            if (auto* render_cluster = bundle.FindRenderCluster(id.cluster_id)) {
+                render_cluster->flags = bundle.FindHandle(flags_id);
+                draws.Invalidate();
             }
         }
     }
@@ -612,8 +2159,10 @@ protected:
                 if (target.target_id == target_id) {
                     target.passes.Process([&](auto& pass) {
                         if (pass.technique_id == technique_id) {
-                            if (pass.auto_uniforms_id != uniforms_id) {
-                                pass.auto_uniforms_id = uniforms_id;
+                            const auto uniforms = bundle.FindHandle(uniforms_id);
+                            if (pass.auto_uniforms != uniforms) {
+                                pass.auto_uniforms = uniforms;
+                                draws.Invalidate();
                             }
                         }
                     });
@@ -622,6 +2171,37 @@ protected:
         }
     }
 
+    Id Spawn(const Id& batch_id, const Vector3& position, const Quaternion& rotation) {
+        if (auto* cluster = bundle.FindCluster(batch_id.cluster_id))
+            if (const auto* batch = cluster->ConstFind(batch_id.batch_id)) {
+                auto* spawned = spawns.Find(batch_id.cluster_id, batch_id.batch_id);
+                if (!spawned) {
+                    spawned = spawns.Add(batch_id.cluster_id, batch_id.batch_id);
+                    draws.Invalidate();
+                }
+                const Instance instance(rotation, position);
+                const auto handle = spawned->Instances().Add(instance);
+                if (handle != SlotMap<Instance, SpawnBatch::InstanceMaxCount>::InvalidHandle) {
+                    const Id id(batch_id.cluster_id, batch_id.batch_id, Id::SpawnedBit | handle);
+                    spawned->SetProxy(handle, overlaps.Add(id, instance, batch->Extents()));
+                    spawned->Invalidate();
+                    return id;
+                }
+                DEBUG_ONLY(Log::Put("Spawn batch %016llx is full\n", batch_id.batch_id);)
+            }
+        return Id();
+    }
+
+    void Destroy(const Id& id) {
+        if (id.IsSpawned())
+            if (auto* spawned = spawns.Find(id.cluster_id, id.batch_id))
+                if (spawned->Instances().Remove(id.instance_id & ~Id::SpawnedBit)) {
+                    overlaps.Remove(spawned->Proxy(id.instance_id & ~Id::SpawnedBit));
+                    spawned->Invalidate();
+                    hierarchy.Remove(id);
+                }
+    }
+
     void SetUniform(uint64 uniforms_id, unsigned index, float value) {
         if (auto* uniforms = bundle.Find<Uniforms>(uniforms_id)) {
             if (index < 4 * Uniforms::UniformMaxCount) {
@@ -650,6 +2230,7 @@ protected:
     float GetAspectRatio() const { return context.AspectRatio(); }
     Vector2 GetWindowSize() const { return context.WindowSize(); }
     uint64 GetGPUFrameDuration() const { return gpu_frame_duration; }
+    RenderStats GetRenderStats() const { return stats; }
     void SetDynamicScale(float scale) { context.SetDynamicScale(scale); }
 
     unsigned WindowWidth() const { return context.WindowWidth(); }
@@ -660,24 +2241,22 @@ class Control : public Render {
     Commands commands;
 
     void LoadAll() {
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Script: ((ScriptDynamic&)data).Load(bundle); break;
-            default: break;
-            }
+        bundle.ProcessType<Data::Type::Dictionary>([&](auto& data) {
+            ((DictionaryDynamic&)data).Load(bundle);
+        });
+        bundle.ProcessType<Data::Type::Script>([&](auto& data) {
+            ((ScriptDynamic&)data).Load(bundle);
         });
     }
 
     void UnloadAll() {
-        bundle.Process([&](auto& data) {
-            switch (Data::DataTypeFromId(data.Id())) {
-            case Data::Type::Script: ((ScriptDynamic*)&data)->~ScriptDynamic(); break;
-            default: break;
-            }
+        bundle.ProcessType<Data::Type::Script>([&](auto& data) {
+            ((ScriptDynamic*)&data)->~ScriptDynamic();
         });
     }
 
     void Call(float elapsed_time) {
+        PROFILE_ZONE("Control::Call", Color::Orange);
         bundle.ProcessScriptClusters([&](auto& script_cluster) {
             if (auto* script = bundle.Find<ScriptDynamic>(script_cluster.script_id))
                 script->Execute(elapsed_time, WindowWidth(), WindowHeight());
@@ -685,28 +2264,31 @@ class Control : public Render {
     }
 
     void Chase() {
-        for (unsigned i = 0; i < Follow::BucketMaxCount; ++i) {
-            bundle.ProcessFollowClusters([&](auto& follow_cluster) {
-                follow_cluster.follow_ids.ProcessIndex([&](uint64 follow_id, unsigned index) {
-                    if (auto* follow = bundle.Find<Follow>(follow_id))
-                        if (follow->GetBucketIndex() == i)
-                            if (auto* followed_follow_cluster = bundle.FindFollowCluster(follow->FollowedClusterId()))
-                                if (auto* followed_cluster = bundle.FindCluster(follow->FollowedClusterId()))
-                                    if (auto* followed_batch = followed_cluster->Find(follow->FollowedBatchId())) {
-                                        follow->Update(follow_cluster.cluster->Batches()[index], *followed_batch);
-                                        follow_cluster.cluster->ComputeBounds();
-                                    }
-                });
-            });
-        }
+        PROFILE_ZONE("Control::Chase", Color::Maroon);
+        bundle.ProcessFollowRecords([&](auto& follow_record) {
+            if (auto* follow = bundle.Get<Follow>(follow_record.follow)) {
+                auto& cluster = bundle.GetCluster(follow_record.cluster_index);
+                const auto& followed_cluster = bundle.GetCluster(follow_record.followed_cluster_index);
+                auto& batch = cluster.Batches()[follow_record.batch_index];
+                if (!follow->Update(batch, followed_cluster.Batches()[follow_record.followed_batch_index]))
+                    return; // Settled batches stay clean, so their bounds and subtrees are left alone.
+                cluster.Invalidate(batch);
+                if (!hierarchy.IsEmpty())
+                    batch.Instances().ConstProcessIndex([&](auto& instance, unsigned index) {
+                        hierarchy.Sync(Id(cluster.Id(), batch.Id(), index), instance);
+                    });
+            }
+        });
     }
 
     template<typename F> void Apply(const Id& id, F func) { // TODO: Remove.
         if (auto follow_cluster = bundle.FindFollowCluster(id.cluster_id))
             follow_cluster->follow_ids.ProcessIndex([&](uint64 follow_id, unsigned index) {
                 auto& batch = follow_cluster->cluster->Batches()[index];
-                if (batch.Id() == id.batch_id)
+                if (batch.Id() == id.batch_id) {
                     func(batch);
+                    follow_cluster->cluster->Invalidate(batch);
+                }
             });
     }
 
@@ -730,14 +2312,54 @@ protected:
     }
 
     void Update() {
-        DEBUG_ONLY(profile.BeginCPU(timer.Now(), Color::Red);)
+        PROFILE_ZONE("Control", Color::Red);
         Call(timer.ElapsedTime());
         Chase();
-        DEBUG_ONLY(profile.EndCPU(timer.Now());)
+        Propagate();
+    }
+
+    Instance* FindInstance(const Id& id) {
+        if (id.IsSpawned())
+            return spawns.FindInstance(id);
+        if (auto* cluster = bundle.FindCluster(id.cluster_id))
+            if (auto* batch = cluster->Find(id.batch_id))
+                if (id.instance_id < batch->Instances().UsedCount())
+                    return &batch->Instances()[id.instance_id];
+        return nullptr;
+    }
+
+    void Propagate() {
+        PROFILE_ZONE("Control::Propagate", Color::Purple);
+        hierarchy.Update([&](const Id& id, const Quaternion& rotation, const Vector3& position) {
+            if (auto* instance = FindInstance(id)) {
+                instance->rotation = rotation;
+                instance->position = position;
+                Invalidate(id);
+            }
+        });
+    }
+
+    void Invalidate(const Id& id) {
+        if (id.IsSpawned()) {
+            if (auto* spawned = spawns.Find(id.cluster_id, id.batch_id))
+                spawned->Invalidate();
+        } else if (auto* cluster = bundle.FindCluster(id.cluster_id)) {
+            if (auto* batch = cluster->Find(id.batch_id))
+                cluster->Invalidate(*batch);
+        }
+    }
+
+    void SetParent(const Id& id, const Id& parent_id) {
+        hierarchy.Link(id, parent_id, [&](const Id& id) { return FindInstance(id); });
     }
 
     Quaternion GetRotation(const Id& id) {
         Quaternion quaternion;
+        if (id.IsSpawned()) {
+            if (auto* instance = spawns.FindInstance(id))
+                quaternion = instance->rotation;
+            return quaternion;
+        }
         Apply(id, [&](auto& batch) {
             quaternion = batch.Instances()[id.instance_id].rotation;
         });
@@ -746,19 +2368,44 @@ protected:
 
     Vector3 GetPosition(const Id& id) {
         Vector3 position(0.f);
+        if (id.IsSpawned()) {
+            if (auto* instance = spawns.FindInstance(id))
+                position = instance->position;
+            return position;
+        }
         Apply(id, [&](auto& batch) {
             position = batch.Instances()[id.instance_id].position;
         });
         return position;
     }
 
-    void SetPosition(const Id& id, const Vector3& position) { // TODO: Missing cluster->ComputeBounds().
+    void SetPosition(const Id& id, const Vector3& position) {
+        if (hierarchy.SetLocalPosition(id, position))
+            return;
+        if (id.IsSpawned()) {
+            if (auto* spawned = spawns.Find(id.cluster_id, id.batch_id))
+                if (auto* instance = spawned->Instances().Find(id.instance_id & ~Id::SpawnedBit)) {
+                    instance->position = position;
+                    spawned->Invalidate();
+                }
+            return;
+        }
         Apply(id, [&](auto& batch) {
             batch.Instances()[id.instance_id].position = position;
         });
     }
 
     void SetRotation(const Id& id, const Quaternion& rotation) {
+        if (hierarchy.SetLocalRotation(id, rotation))
+            return;
+        if (id.IsSpawned()) {
+            if (auto* spawned = spawns.Find(id.cluster_id, id.batch_id))
+                if (auto* instance = spawned->Instances().Find(id.instance_id & ~Id::SpawnedBit)) {
+                    instance->rotation = rotation;
+                    spawned->Invalidate();
+                }
+            return;
+        }
         Apply(id, [&](auto& batch) {
             batch.Instances()[id.instance_id].rotation = rotation;
         });
@@ -766,7 +2413,7 @@ protected:
 
     float GetValue(uint64 dictionary_id, uint32 hash) {
         float value = 0.0f;
-        if (auto* dictionary = bundle.Find<Dictionary>(dictionary_id)) {
+        if (auto* dictionary = bundle.Find<DictionaryDynamic>(dictionary_id)) {
             return dictionary->Find(hash);
         }
         return value;
@@ -809,28 +2456,72 @@ public:
         commands.get_aspect_ratio = []() { return engine->GetAspectRatio(); };
         commands.get_window_size = []() { return engine->GetWindowSize(); };
         commands.get_gpu_frame_duration = []() { return engine->GetGPUFrameDuration(); };
+        commands.get_frame_percentiles = [](Metric metric) { return engine->GetFramePercentiles(metric); };
+        commands.get_render_stats = []() { return engine->GetRenderStats(); };
+        commands.write_memory_report = []() { engine->WriteMemoryReport(); };
+        commands.set_hitch_budget = [](uint64 budget) { PROFILE_ONLY(engine->SetHitchBudget(budget);) };
         commands.set_dynamic_scale = [](float scale) { return engine->SetDynamicScale(scale); };
         commands.get_rotation = [](const Id& id) { return engine->GetRotation(id); };
         commands.get_position = [](const Id& id) { return engine->GetPosition(id); };
         commands.set_position = [](const Id& id, const Vector3& position) { engine->SetPosition(id, position); };
         commands.set_rotation = [](const Id& id, const Quaternion& rotation) { engine->SetRotation(id, rotation); };
+        commands.set_parent = [](const Id& id, const Id& parent_id) { engine->SetParent(id, parent_id); };
         commands.pick = [](const Id& camera_id, float u, float v, unsigned flags, Ray& out_ray) { return engine->Pick(camera_id, u, v, flags, out_ray); };
+        commands.cast_rays = [](const RayQuery* queries, unsigned count, RayHit* out_hits) { engine->CastRays(queries, count, out_hits); };
+        commands.cast_screen_rays = [](const Id& camera_id, const Vector2* points, unsigned count, unsigned flags, RayHit* out_hits) { engine->CastScreenRays(camera_id, points, count, flags, out_hits); };
+        commands.overlap_pairs = [](OverlapPair* out_pairs, unsigned max_count) { return engine->OverlapPairs(out_pairs, max_count); };
+        commands.overlap_box = [](const Vector3& position, const Quaternion& rotation, const Vector3& extents, Id* out_ids, unsigned max_count) { return engine->OverlapBox(position, rotation, extents, out_ids, max_count); };
+        commands.overlap_aabb = [](const Vector3& min, const Vector3& max, Id* out_ids, unsigned max_count) { return engine->OverlapAabb(min, max, out_ids, max_count); };
         commands.swap_surface = [](const Id& id, unsigned index, uint64 texture_id) { engine->SwapSurface(id, index, texture_id); };
         commands.swap_uniforms = [](const Id& id, uint64 uniforms_id) { engine->SwapUniforms(id, uniforms_id); };
+        commands.swap_flags = [](const Id& id, uint64 flags_id) { engine->SwapFlags(id, flags_id); };
         commands.swap_pass_uniforms = [](uint64 camera_id, uint32 target_id, uint32 technique_id, uint64 uniforms_id) { engine->SwapPassUniforms(camera_id, target_id, technique_id, uniforms_id); };
         commands.set_uniform = [](uint64 uniforms_id, unsigned index, float value) { engine->SetUniform(uniforms_id, index, value); };
+        commands.spawn = [](const Id& batch_id, const Vector3& position, const Quaternion& rotation) { return engine->Spawn(batch_id, position, rotation); };
+        commands.destroy = [](const Id& id) { engine->Destroy(id); };
         commands.draw_cluster_box = [](const Id& id) { DEBUG_ONLY(engine->DrawClusterBox(id);) };
         commands.draw_point = [](const Vector3& point, const Vector3& color) { DEBUG_ONLY(engine->DrawDebugPoint(point, color);) };
         commands.play = [](const Id& id, uint32 sound_id, float volume) { return engine->Play(id, sound_id, volume); };
         Init(commands);
     }
 
+    ~Engine() {
+        telemetry.Write(Telemetry::Name());
+        PROFILE_ONLY(profile.WriteZones(Profile::ZonesName());)
+        WriteMemoryReport();
+    }
+
     void Update() {
         timer.Tick();
+        const uint64 frame_begin_time = timer.Now();
+        PROFILE_ONLY(profile.BeginFrame(frame_begin_time);)
         Control::Update();
+        const uint64 control_end_time = timer.Now();
         Audio::Update();
+        const uint64 audio_end_time = timer.Now();
         Render::Update();
+        const uint64 render_end_time = timer.Now();
+        telemetry.Add(Metric::Control, control_end_time - frame_begin_time);
+        telemetry.Add(Metric::Audio, audio_end_time - control_end_time);
+        telemetry.Add(Metric::Render, render_end_time - audio_end_time);
+        telemetry.Add(Metric::CPUFrame, render_end_time - frame_begin_time);
+        telemetry.Add(Metric::GPUFrame, GetGPUFrameDuration());
+        PROFILE_ONLY(if (profile.EndFrame(render_end_time, GetGPUFrameDuration())) WriteHitch();)
     }
+
+    void WriteHitch() {
+        char filename[String::MaxSize];
+        Text::Format(filename, String::MaxSize, "hitch_%llu.json", profile.FrameCount());
+        profile.WriteTrace(filename);
+    }
+
+    void SetHitchBudget(uint64 budget) { profile.SetHitchBudget(budget); }
+
+    void WriteMemoryReport() {
+        MemoryReport(bundle).Write(MemoryReport::Name());
+    }
+
+    Percentiles GetFramePercentiles(Metric metric) const { return telemetry.Get(metric); }
 };
 
 Engine* Engine::engine = nullptr;
@@ -129,6 +129,8 @@ enum class Key : uint8 {
 };
 
 struct Id {
+    static const uint32 SpawnedBit = 1u << 31; // Instance id is a generational handle into the spawned instances.
+
     uint64 cluster_id = 0;
     uint64 batch_id = 0;
     uint32 instance_id = 0;
@@ -147,10 +149,70 @@ struct Id {
 
     operator bool() const { return (cluster_id != 0) || (batch_id != 0); }
 
+    bool IsSpawned() const { return (instance_id & SpawnedBit) != 0; }
+
     bool operator!=(const Id& other) const { return (cluster_id != other.cluster_id) || (batch_id != other.batch_id) || (instance_id != other.instance_id); }
     bool operator==(const Id& other) const { return (cluster_id == other.cluster_id) && (batch_id == other.batch_id) && (instance_id == other.instance_id); }
 };
 
+namespace Hash {
+    static unsigned Key(const Id& id) { return Key(id.cluster_id ^ (id.batch_id * 31) ^ ((uint64)id.instance_id * 0x9E3779B97F4A7C15ull)); }
+};
+
+enum class Metric : uint8 {
+    CPUFrame = 0,
+    GPUFrame,
+    Control,
+    Audio,
+    Render,
+    Count
+};
+
+struct Percentiles {
+    uint64 p50 = 0;
+    uint64 p95 = 0;
+    uint64 p99 = 0;
+    uint64 max = 0;
+};
+
+struct RenderStats {
+    uint32 cameras = 0;
+    uint32 targets = 0;
+    uint32 passes = 0;
+    uint32 clusters_tested = 0;
+    uint32 clusters_culled = 0;
+    uint32 batches_tested = 0;
+    uint32 batches_culled = 0;
+    uint32 instances_culled = 0;
+    uint32 occlusion_culled = 0;
+    uint32 draws = 0;
+    uint32 instances = 0;
+    uint32 shader_switches = 0;
+    uint32 surface_binds = 0;
+    uint32 constant_updates = 0;
+    uint64 stack_bytes = 0;
+};
+
+struct RayQuery {
+    Vector3 from;
+    Vector3 to;
+    unsigned flags = 0;
+};
+
+struct RayHit {
+    Id id; // Empty when the ray hit nothing.
+    Vector3 position;
+    float distance = 0.f;
+};
+
+struct OverlapPair {
+    Id a;
+    Id b;
+
+    OverlapPair() {}
+    OverlapPair(const Id& a, const Id& b) : a(a), b(b) {}
+};
+
 typedef bool(*IsRelease)();
 typedef void(*ToggleProfileJobs)();
 typedef void(*ToggleDrawBounds)();
@@ -161,16 +223,30 @@ typedef Vector2(*GetDynamicScale)();
 typedef float(*GetAspectRatio)();
 typedef Vector2(*GetWindowSize)();
 typedef uint64(*GetGpuFrameDuration)();
+typedef Percentiles(*GetFramePercentiles)(Metric metric);
+typedef RenderStats(*GetRenderStats)();
+typedef void(*SetHitchBudget)(uint64 budget);
+typedef void(*WriteMemoryReport)();
 typedef void(*SetDynamicScale)(float scale);
 typedef Quaternion(*GetRotation)(const Id& id);
 typedef Vector3(*GetPosition)(const Id& id);
 typedef void(*SetPosition)(const Id& id, const Vector3& position);
 typedef void(*SetRotation)(const Id& id, const Quaternion& rotation);
+typedef void(*SetParent)(const Id& id, const Id& parent_id);
 typedef Id(*Pick)(const Id& camera_id, float u, float v, unsigned flags, Ray& out_ray);
+typedef void(*CastRays)(const RayQuery* queries, unsigned count, RayHit* out_hits);
+typedef void(*CastScreenRays)(const Id& camera_id, const Vector2* points, unsigned count, unsigned flags, RayHit* out_hits);
+// Overlap commands write at most max_count results and return the total found.
+typedef unsigned(*OverlapPairs)(OverlapPair* out_pairs, unsigned max_count);
+typedef unsigned(*OverlapBox)(const Vector3& position, const Quaternion& rotation, const Vector3& extents, Id* out_ids, unsigned max_count);
+typedef unsigned(*OverlapAabb)(const Vector3& min, const Vector3& max, Id* out_ids, unsigned max_count);
 typedef void(*SwapSurface)(const Id& id, unsigned index, uint64 texture_id);
 typedef void(*SwapUniforms)(const Id& id, uint64 uniforms_id);
 typedef void(*SwapPassUniforms)(uint64 camera_id, uint32 target_id, uint32 technique_id, uint64 uniforms_id);
+typedef void(*SwapFlags)(const Id& id, uint64 flags_id);
 typedef void(*SetUniform)(uint64 uniforms_id, unsigned index, float value);
+typedef Id(*Spawn)(const Id& batch_id, const Vector3& position, const Quaternion& rotation);
+typedef void(*Destroy)(const Id& id);
 typedef void(*DrawClusterBox)(const Id& id);
 typedef void(*DrawPoint)(const Vector3& point, const Vector3& color);
 typedef bool(*Play)(const Id& id, uint32 sound_id, float volume);
@@ -186,16 +262,29 @@ struct Commands {
     GetAspectRatio get_aspect_ratio;
     GetWindowSize get_window_size;
     GetGpuFrameDuration get_gpu_frame_duration;
+    GetFramePercentiles get_frame_percentiles;
+    GetRenderStats get_render_stats;
+    SetHitchBudget set_hitch_budget;
+    WriteMemoryReport write_memory_report;
     SetDynamicScale set_dynamic_scale;
     GetRotation get_rotation;
     GetPosition get_position;
     SetPosition set_position;
     SetRotation set_rotation;
+    SetParent set_parent;
     Pick pick;
+    CastRays cast_rays;
+    CastScreenRays cast_screen_rays;
+    OverlapPairs overlap_pairs;
+    OverlapBox overlap_box;
+    OverlapAabb overlap_aabb;
     SwapSurface swap_surface;
     SwapUniforms swap_uniforms;
     SwapPassUniforms swap_pass_uniforms;
+    SwapFlags swap_flags;
     SetUniform set_uniform;
+    Spawn spawn;
+    Destroy destroy;
     DrawClusterBox draw_cluster_box;
     DrawPoint draw_point;
     Play play;
@@ -74,6 +74,16 @@ namespace Math {
         return n;
     }
 
+    static unsigned TrailingZeros(uint64 x) { // Index of the lowest set bit, x must not be 0.
+#if defined(_MSC_VER)
+        unsigned long index = 0;
+        _BitScanForward64(&index, x);
+        return (unsigned)index;
+#else
+        return (unsigned)__builtin_ctzll(x);
+#endif
+    }
+
     static constexpr bool IsPowerOf2(unsigned x) { return (( x & (x-1)) == 0); }
 
     static constexpr uint32 NextPowerOf2(uint32 x) {
@@ -244,6 +254,8 @@ namespace Hash {
 
     static uint64 Fnv64(const char* s) { return Fnv64(s, Math::Length(s)); }
     static uint32 Fnv32(const char* s) { return Fnv32(s, Math::Length(s)); }
+
+    static unsigned Key(uint64 key) { return (unsigned)(key ^ (key >> 32)); }
 };
 
 namespace Scan {
@@ -543,6 +555,214 @@ public:
     }
 };
 
+class Float4 { // Four float lanes, SSE on x64 and NEON on ARM.
+#if defined(__ARM_NEON)
+    float32x4_t v;
+
+    Float4(float32x4_t v) : v(v) {}
+    Float4(uint32x4_t m) : v(vreinterpretq_f32_u32(m)) {}
+
+    uint32x4_t Bits() const { return vreinterpretq_u32_f32(v); }
+
+public:
+    Float4() : v(vdupq_n_f32(0.f)) {}
+    Float4(float f) : v(vdupq_n_f32(f)) {}
+
+    static Float4 Load(const float* p) { return Float4(vld1q_f32(p)); }
+    void Store(float* p) const { vst1q_f32(p, v); }
+
+    Float4 operator+(const Float4& o) const { return Float4(vaddq_f32(v, o.v)); }
+    Float4 operator-(const Float4& o) const { return Float4(vsubq_f32(v, o.v)); }
+    Float4 operator*(const Float4& o) const { return Float4(vmulq_f32(v, o.v)); }
+    Float4 operator-() const { return Float4(vnegq_f32(v)); }
+
+    Float4 operator>(const Float4& o) const { return Float4(vcgtq_f32(v, o.v)); }
+    Float4 operator>=(const Float4& o) const { return Float4(vcgeq_f32(v, o.v)); }
+    Float4 operator|(const Float4& o) const { return Float4(vorrq_u32(Bits(), o.Bits())); }
+
+    Float4 Abs() const { return Float4(vabsq_f32(v)); }
+    Float4 Min(const Float4& o) const { return Float4(vminq_f32(v, o.v)); }
+    Float4 Max(const Float4& o) const { return Float4(vmaxq_f32(v, o.v)); }
+
+    Float4 InvSqrt() const {
+        float32x4_t e = vrsqrteq_f32(v);
+        e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(v, e), e));
+        e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(v, e), e));
+        return Float4(e);
+    }
+
+    unsigned Mask() const { // One bit per lane set in a comparison result.
+        static const int32_t shifts[4] = { 0, 1, 2, 3 };
+        return vaddvq_u32(vshlq_u32(vshrq_n_u32(Bits(), 31), vld1q_s32(shifts)));
+    }
+
+    static Float4 Select(const Float4& mask, const Float4& a, const Float4& b) { return Float4(vbslq_f32(mask.Bits(), a.v, b.v)); }
+
+    static void Transpose(Float4& a, Float4& b, Float4& c, Float4& d) {
+        const float32x4x2_t ab = vtrnq_f32(a.v, b.v);
+        const float32x4x2_t cd = vtrnq_f32(c.v, d.v);
+        a.v = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b.v = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c.v = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d.v = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+#else
+    __m128 v;
+
+    Float4(__m128 v) : v(v) {}
+
+public:
+    Float4() : v(_mm_setzero_ps()) {}
+    Float4(float f) : v(_mm_set1_ps(f)) {}
+
+    static Float4 Load(const float* p) { return Float4(_mm_loadu_ps(p)); }
+    void Store(float* p) const { _mm_storeu_ps(p, v); }
+
+    Float4 operator+(const Float4& o) const { return Float4(_mm_add_ps(v, o.v)); }
+    Float4 operator-(const Float4& o) const { return Float4(_mm_sub_ps(v, o.v)); }
+    Float4 operator*(const Float4& o) const { return Float4(_mm_mul_ps(v, o.v)); }
+    Float4 operator-() const { return Float4(_mm_xor_ps(v, _mm_set1_ps(-0.f))); }
+
+    Float4 operator>(const Float4& o) const { return Float4(_mm_cmpgt_ps(v, o.v)); }
+    Float4 operator>=(const Float4& o) const { return Float4(_mm_cmpge_ps(v, o.v)); }
+    Float4 operator|(const Float4& o) const { return Float4(_mm_or_ps(v, o.v)); }
+
+    Float4 Abs() const { return Float4(_mm_andnot_ps(_mm_set1_ps(-0.f), v)); }
+    Float4 Min(const Float4& o) const { return Float4(_mm_min_ps(v, o.v)); }
+    Float4 Max(const Float4& o) const { return Float4(_mm_max_ps(v, o.v)); }
+
+    Float4 InvSqrt() const { // Estimate refined by one Newton-Raphson step.
+        const __m128 e = _mm_rsqrt_ps(v);
+        const __m128 e2 = _mm_mul_ps(_mm_mul_ps(v, e), e);
+        return Float4(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), e), _mm_sub_ps(_mm_set1_ps(3.f), e2)));
+    }
+
+    unsigned Mask() const { return (unsigned)_mm_movemask_ps(v); } // One bit per lane set in a comparison result.
+
+    static Float4 Select(const Float4& mask, const Float4& a, const Float4& b) { return Float4(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))); }
+
+    static void Transpose(Float4& a, Float4& b, Float4& c, Float4& d) { _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v); }
+#endif
+};
+
+class Vector3Lanes { // Four vectors, one component per register.
+public:
+    Float4 x, y, z;
+
+    Vector3Lanes() {}
+    Vector3Lanes(const Float4& x, const Float4& y, const Float4& z) : x(x), y(y), z(z) {}
+    Vector3Lanes(const Vector3& v) : x(v.x), y(v.y), z(v.z) {}
+
+    Vector3Lanes operator+(const Vector3Lanes& o) const { return Vector3Lanes(x + o.x, y + o.y, z + o.z); }
+    Vector3Lanes operator-(const Vector3Lanes& o) const { return Vector3Lanes(x - o.x, y - o.y, z - o.z); }
+    Vector3Lanes operator*(const Float4& f) const { return Vector3Lanes(x * f, y * f, z * f); }
+
+    Float4 Dot(const Vector3Lanes& o) const { return x * o.x + y * o.y + z * o.z; }
+    Vector3Lanes Cross(const Vector3Lanes& o) const { return Vector3Lanes(y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x); }
+    Float4 SquareDistance(const Vector3Lanes& o) const { return (o - *this).Dot(o - *this); }
+
+    Vector3Lanes Lerp(const Vector3Lanes& o, const Float4& s) const { return *this + (o - *this) * s; }
+
+    static Vector3Lanes Select(const Float4& mask, const Vector3Lanes& a, const Vector3Lanes& b) {
+        return Vector3Lanes(Float4::Select(mask, a.x, b.x), Float4::Select(mask, a.y, b.y), Float4::Select(mask, a.z, b.z));
+    }
+
+    static Vector3Lanes CubicHermite(const Vector3Lanes& va, const Vector3Lanes& vb, const Vector3Lanes& ta, const Vector3Lanes& tb, const Float4& s) {
+        const auto s2 = s * s;
+        const auto s3 = s2 * s;
+        return va * (Float4(2.f) * s3 - Float4(3.f) * s2 + Float4(1.f)) + vb * (Float4(-2.f) * s3 + Float4(3.f) * s2) + ta * (s3 - Float4(2.f) * s2 + s) + tb * (s3 - s2);
+    }
+};
+
+class QuaternionLanes { // Four quaternions, one component per register.
+public:
+    static constexpr float NlerpMinCos = 0.9f; // Below ~50 degrees corrected nlerp stays within slerp precision.
+
+    Float4 x, y, z, w;
+
+    QuaternionLanes() {}
+    QuaternionLanes(const Float4& x, const Float4& y, const Float4& z, const Float4& w) : x(x), y(y), z(z), w(w) {}
+
+    QuaternionLanes operator+(const QuaternionLanes& o) const { return QuaternionLanes(x + o.x, y + o.y, z + o.z, w + o.w); }
+    QuaternionLanes operator-(const QuaternionLanes& o) const { return QuaternionLanes(x - o.x, y - o.y, z - o.z, w - o.w); }
+    QuaternionLanes operator*(const Float4& f) const { return QuaternionLanes(x * f, y * f, z * f, w * f); }
+    QuaternionLanes operator*(const QuaternionLanes& o) const {
+        return QuaternionLanes(
+            o.w * x + o.x * w + o.y * z - o.z * y,
+            o.w * y + o.y * w + o.z * x - o.x * z,
+            o.w * z + o.z * w + o.x * y - o.y * x,
+            o.w * w - o.x * x - o.y * y - o.z * z);
+    }
+
+    Float4 Dot(const QuaternionLanes& o) const { return x * o.x + y * o.y + z * o.z + w * o.w; }
+    Float4 SquareDistance(const QuaternionLanes& o) const { return (o - *this).Dot(o - *this); }
+
+    QuaternionLanes Normalize() const { return *this * Dot(*this).InvSqrt(); }
+
+    Vector3Lanes Transform(const Vector3Lanes& v) const {
+        const Vector3Lanes u(x, y, z);
+        const Vector3Lanes t = u.Cross(v) * Float4(2.f);
+        return v + t * w + u.Cross(t);
+    }
+
+    static QuaternionLanes Select(const Float4& mask, const QuaternionLanes& a, const QuaternionLanes& b) {
+        return QuaternionLanes(Float4::Select(mask, a.x, b.x), Float4::Select(mask, a.y, b.y), Float4::Select(mask, a.z, b.z), Float4::Select(mask, a.w, b.w));
+    }
+
+    QuaternionLanes Slerp(const QuaternionLanes& o, float t) const {
+        const Float4 cos_theta = Dot(o);
+        const Float4 alpha = Float4::Select(cos_theta >= Float4(0.f), Float4(1.f), Float4(-1.f));
+        const Float4 d = cos_theta.Abs();
+        if ((d >= Float4(NlerpMinCos)).Mask() == 0xF)
+            return (*this * alpha).Nlerp(o, d, t); // Keeps the sign of o like Eberly does.
+        return Eberly(o, cos_theta, alpha, t);
+    }
+
+private:
+    QuaternionLanes Nlerp(const QuaternionLanes& o, const Float4& d, float t) const { // Nlerp with t warped to follow the slerp arc.
+        const float t0 = t - 0.5f;
+        const Float4 a = Float4(1.0904f) + d * (Float4(-3.2452f) + d * (Float4(3.55645f) - d * Float4(1.43519f)));
+        const Float4 b = Float4(0.848013f) + d * (Float4(-1.06021f) + d * Float4(0.215638f));
+        const Float4 k = a * Float4(t0 * t0) + b;
+        const Float4 ot = Float4(t) + Float4(t * t0 * (t - 1.f)) * k;
+        return (*this + (o - *this) * ot).Normalize();
+    }
+
+    QuaternionLanes Eberly(const QuaternionLanes& o, const Float4& cos_theta, const Float4& alpha, float t) const { // Quaternion::Slerp across lanes.
+        const Float4 halfY = Float4(1.f) + alpha * cos_theta;
+
+        float f2b = t - 0.5f;
+        float u = f2b >= 0 ? f2b : -f2b;
+        const float f2a = u - f2b;
+        f2b += u;
+        u += u;
+        const float f1 = 1.f - u;
+
+        Float4 halfSecHalfTheta = Float4(1.09f) - (Float4(0.476537f) - Float4(0.0903321f) * halfY) * halfY;
+        halfSecHalfTheta = halfSecHalfTheta * (Float4(1.5f) - halfY * halfSecHalfTheta * halfSecHalfTheta);
+        const Float4 versHalfTheta = Float4(1.f) - halfY * halfSecHalfTheta;
+
+        const float sqNotU = f1 * f1;
+        Float4 ratio2 = Float4(0.0000440917108f) * versHalfTheta;
+        Float4 ratio1 = Float4(-0.00158730159f) + Float4(sqNotU - 16.f) * ratio2;
+        ratio1 = Float4(0.0333333333f) + ratio1 * Float4(sqNotU - 9.f) * versHalfTheta;
+        ratio1 = Float4(-0.333333333f) + ratio1 * Float4(sqNotU - 4.f) * versHalfTheta;
+        ratio1 = Float4(1.f) + ratio1 * Float4(sqNotU - 1.f) * versHalfTheta;
+
+        const float sqU = u * u;
+        ratio2 = Float4(-0.00158730159f) + Float4(sqU - 16.f) * ratio2;
+        ratio2 = Float4(0.0333333333f) + ratio2 * Float4(sqU - 9.f) * versHalfTheta;
+        ratio2 = Float4(-0.333333333f) + ratio2 * Float4(sqU - 4.f) * versHalfTheta;
+        ratio2 = Float4(1.f) + ratio2 * Float4(sqU - 1.f) * versHalfTheta;
+
+        const Float4 g1 = Float4(f1) * ratio1 * halfSecHalfTheta;
+        const Float4 ga = alpha * (g1 + Float4(f2a) * ratio2);
+        const Float4 gb = g1 + Float4(f2b) * ratio2;
+
+        return *this * ga + o * gb;
+    }
+};
+
 class Matrix {
 public:
     Vector4 row0 = Vector4(1.f, 0.f, 0.f, 0.f);
@@ -783,21 +1003,61 @@ struct Box {
     Box() {}
     Box(const Vector3& extents) : extents(extents) {}
 
-    bool Intersect(Ray& ray, const Quaternion& rotation, const Vector3& position) const {
+    Vector3 Enclose(const Quaternion& rotation) const { // Axis-aligned half size around the box oriented as in Intersect.
+        return (rotation.Right() * extents.x).Absolute() + (rotation.Up() * extents.y).Absolute() + (rotation.At() * extents.z).Absolute();
+    }
+
+    bool Overlap(const Quaternion& rotation, const Vector3& position, const Box& other, const Quaternion& other_rotation, const Vector3& other_position) const { // Separating axis test.
+        const Vector3 a[3] = { rotation.Right(), rotation.Up(), rotation.At() };
+        const Vector3 b[3] = { other_rotation.Right(), other_rotation.Up(), other_rotation.At() };
+        const float ea[3] = { extents.x, extents.y, extents.z };
+        const float eb[3] = { other.extents.x, other.extents.y, other.extents.z };
+        const auto d = other_position - position;
+        const float t[3] = { d.Dot(a[0]), d.Dot(a[1]), d.Dot(a[2]) };
+        float r[3][3], abs_r[3][3];
+        for (unsigned i = 0; i < 3; ++i) {
+            for (unsigned j = 0; j < 3; ++j) {
+                r[i][j] = a[i].Dot(b[j]);
+                abs_r[i][j] = Math::Abs(r[i][j]) + 1e-6f; // Keeps parallel edges from producing a null cross axis.
+            }
+        }
+        for (unsigned i = 0; i < 3; ++i)
+            if (Math::Abs(t[i]) > ea[i] + eb[0] * abs_r[i][0] + eb[1] * abs_r[i][1] + eb[2] * abs_r[i][2])
+                return false;
+        for (unsigned j = 0; j < 3; ++j)
+            if (Math::Abs(t[0] * r[0][j] + t[1] * r[1][j] + t[2] * r[2][j]) > ea[0] * abs_r[0][j] + ea[1] * abs_r[1][j] + ea[2] * abs_r[2][j] + eb[j])
+                return false;
+        for (unsigned i = 0; i < 3; ++i) {
+            const unsigned i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+            for (unsigned j = 0; j < 3; ++j) {
+                const unsigned j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+                const float ra = ea[i1] * abs_r[i2][j] + ea[i2] * abs_r[i1][j];
+                const float rb = eb[j1] * abs_r[i][j2] + eb[j2] * abs_r[i][j1];
+                if (Math::Abs(t[i2] * r[i1][j] - t[i1] * r[i2][j]) > ra + rb)
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool Span(const Ray& ray, const Quaternion& rotation, const Vector3& position, float& t0, float& t1) const { // Entry and exit distances along the ray.
         const auto ray_diff = ray.from - position;
         const Vector3 diff = rotation.Transform(ray_diff);
         const Vector3 direction = rotation.Transform(ray.direction);
-        float t0 = -Math::Large;
-        float t1 = Math::Large;
-        if (Clip(+direction.x, -diff.x - extents.x, t0, t1) &&
+        t0 = -Math::Large;
+        t1 = Math::Large;
+        return Clip(+direction.x, -diff.x - extents.x, t0, t1) &&
             Clip(-direction.x, +diff.x - extents.x, t0, t1) &&
             Clip(+direction.y, -diff.y - extents.y, t0, t1) &&
             Clip(-direction.y, +diff.y - extents.y, t0, t1) &&
             Clip(+direction.z, -diff.z - extents.z, t0, t1) &&
-            Clip(-direction.z, +diff.z - extents.z, t0, t1)) {
-            if (t0 > 0.f)
-                return ray.ClosestHit(ray.from + ray.direction * t0);
-        }
+            Clip(-direction.z, +diff.z - extents.z, t0, t1);
+    }
+
+    bool Intersect(Ray& ray, const Quaternion& rotation, const Vector3& position) const {
+        float t0, t1;
+        if (Span(ray, rotation, position, t0, t1) && (t0 > 0.f))
+            return ray.ClosestHit(ray.from + ray.direction * t0);
         return false;
     }
 
@@ -815,3 +1075,135 @@ private:
             return numer <= 0.f;
     }
 };
+
+struct Aabb {
+    Vector3 min = Vector3(Math::Large);
+    Vector3 max = Vector3(-Math::Large);
+
+    Aabb() {}
+    Aabb(const Vector3& min, const Vector3& max) :
+        min(min), max(max) {}
+
+    Aabb Merge(const Aabb& other) const { return Aabb(min.Minimum(other.min), max.Maximum(other.max)); }
+    Vector3 Center() const { return (min + max) * 0.5f; }
+
+    float HalfArea() const { // Surface area heuristic cost, empty boxes cost nothing.
+        const auto d = max - min;
+        return (d.x < 0.f) ? 0.f : d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    bool operator==(const Aabb& other) const { return min == other.min && max == other.max; }
+
+    bool Intersect(const Aabb& other) const {
+        return min.x <= other.max.x && max.x >= other.min.x &&
+            min.y <= other.max.y && max.y >= other.min.y &&
+            min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    bool Intersect(const Sphere& sphere) const {
+        const auto closest = sphere.center.Maximum(min).Minimum(max);
+        return closest.SquareDistance(sphere.center) < sphere.radius * sphere.radius;
+    }
+
+    bool Intersect(const Ray& ray) const { // Slab test, boxes beyond the closest hit so far are rejected.
+        float t0 = 0.f;
+        float t1 = ray.hit_fraction * ray.from.Distance(ray.to);
+        return Slab(ray.from.x, ray.direction.x, min.x, max.x, t0, t1) &&
+            Slab(ray.from.y, ray.direction.y, min.y, max.y, t0, t1) &&
+            Slab(ray.from.z, ray.direction.z, min.z, max.z, t0, t1);
+    }
+
+private:
+    static bool Slab(float from, float direction, float min, float max, float& t0, float& t1) {
+        if (direction == 0.f)
+            return from >= min && from <= max;
+        const float inv = 1.f / direction;
+        const float t_near = (min - from) * inv;
+        const float t_far = (max - from) * inv;
+        t0 = Math::Max(t0, Math::Min(t_near, t_far));
+        t1 = Math::Min(t1, Math::Max(t_near, t_far));
+        return t0 <= t1;
+    }
+};
+
+struct Triangle {
+    Vector3 a;
+    Vector3 b;
+    Vector3 c;
+
+    Triangle() {}
+    Triangle(const Vector3& a, const Vector3& b, const Vector3& c) :
+        a(a), b(b), c(c) {}
+
+    Aabb BoundingBox() const { return Aabb(a.Minimum(b).Minimum(c), a.Maximum(b).Maximum(c)); }
+
+    bool Intersect(const Vector3& from, const Vector3& direction, float& t) const { // Two-sided, t is the distance limit on entry and the hit distance on exit.
+        const auto e1 = b - a;
+        const auto e2 = c - a;
+        const auto p = direction.Cross(e2);
+        const float det = e1.Dot(p);
+        if (Math::Abs(det) < 1e-12f)
+            return false;
+        const float inv_det = 1.f / det;
+        const auto s = from - a;
+        const float u = s.Dot(p) * inv_det;
+        if (u < 0.f || u > 1.f)
+            return false;
+        const auto q = s.Cross(e1);
+        const float v = direction.Dot(q) * inv_det;
+        if (v < 0.f || u + v > 1.f)
+            return false;
+        const float d = e2.Dot(q) * inv_det;
+        if (d <= 0.f || d >= t)
+            return false;
+        t = d;
+        return true;
+    }
+};
+
+class RayLanes { // Four rays tested together against boxes, lanes past the ray count never hit.
+    Vector3Lanes from;
+    Vector3Lanes inv_direction;
+    Float4 length;
+    Float4 t_max;
+
+    static float Invert(float d) { return 1.f / (Math::Abs(d) < 1e-20f ? Math::CopySign(1e-20f, d) : d); }
+
+public:
+    RayLanes(const Ray* rays, unsigned count) {
+        float lanes[8][4] = {};
+        for (unsigned i = 0; i < count; ++i) {
+            lanes[0][i] = rays[i].from.x;
+            lanes[1][i] = rays[i].from.y;
+            lanes[2][i] = rays[i].from.z;
+            lanes[3][i] = Invert(rays[i].direction.x);
+            lanes[4][i] = Invert(rays[i].direction.y);
+            lanes[5][i] = Invert(rays[i].direction.z);
+            lanes[6][i] = rays[i].from.Distance(rays[i].to);
+        }
+        for (unsigned i = count; i < 4; ++i)
+            lanes[6][i] = -1.f;
+        from = Vector3Lanes(Float4::Load(lanes[0]), Float4::Load(lanes[1]), Float4::Load(lanes[2]));
+        inv_direction = Vector3Lanes(Float4::Load(lanes[3]), Float4::Load(lanes[4]), Float4::Load(lanes[5]));
+        length = Float4::Load(lanes[6]);
+        Clip(rays, count);
+    }
+
+    void Clip(const Ray* rays, unsigned count) { // Shortens each lane to its closest hit so far.
+        float fractions[4] = { 1.f, 1.f, 1.f, 1.f };
+        for (unsigned i = 0; i < count; ++i)
+            fractions[i] = rays[i].hit_fraction;
+        t_max = length * Float4::Load(fractions);
+    }
+
+    unsigned Intersect(const Aabb& box) const { // Slab test, one bit per lane that hits.
+        const auto t1 = (Vector3Lanes(box.min) - from);
+        const auto t2 = (Vector3Lanes(box.max) - from);
+        const Float4 x1 = t1.x * inv_direction.x, x2 = t2.x * inv_direction.x;
+        const Float4 y1 = t1.y * inv_direction.y, y2 = t2.y * inv_direction.y;
+        const Float4 z1 = t1.z * inv_direction.z, z2 = t2.z * inv_direction.z;
+        const Float4 t_near = x1.Min(x2).Max(y1.Min(y2)).Max(z1.Min(z2)).Max(Float4(0.f));
+        const Float4 t_far = x1.Max(x2).Min(y1.Max(y2)).Min(z1.Max(z2)).Min(t_max);
+        return (t_far >= t_near).Mask();
+    }
+};
@@ -0,0 +1,200 @@
+
+class OcclusionBuffer : public NoCopy { // Low resolution depth of the occluders, with the farthest depth of each tile for early outs.
+public:
+    static const unsigned Width = 256;
+    static const unsigned Height = 128;
+    static const unsigned TileSize = 8;
+    static const unsigned TileWidth = Width / TileSize;
+    static const unsigned TileHeight = Height / TileSize;
+
+private:
+    static constexpr float NearW = 1e-4f; // Anything closer is treated as crossing the near plane.
+    static constexpr float DepthBias = 1e-5f;
+
+    struct Depths {
+        float pixels[Width * Height];
+        float tiles[TileWidth * TileHeight];
+    };
+
+    struct Projected {
+        float x = 0.f; // Pixels.
+        float y = 0.f;
+        float z = 0.f; // Normalized device depth.
+    };
+
+    Depths* depths = nullptr;
+    Matrix viewproj;
+    bool active = false;
+
+    static int Pixel(float v, unsigned limit) { return (int)Math::Floor(Math::Clamp(v, 0.f, (float)limit)); }
+
+    static bool Project(const Matrix& m, const Vector3& p, Projected& out) {
+        const float w = p.x * m.row0.w + p.y * m.row1.w + p.z * m.row2.w + m.row3.w;
+        if (w < NearW)
+            return false;
+        const float inv_w = 1.f / w;
+        const float x = (p.x * m.row0.x + p.y * m.row1.x + p.z * m.row2.x + m.row3.x) * inv_w;
+        const float y = (p.x * m.row0.y + p.y * m.row1.y + p.z * m.row2.y + m.row3.y) * inv_w;
+        out.x = (x * 0.5f + 0.5f) * (float)Width;
+        out.y = (0.5f - y * 0.5f) * (float)Height;
+        out.z = (p.x * m.row0.z + p.y * m.row1.z + p.z * m.row2.z + m.row3.z) * inv_w;
+        return true;
+    }
+
+    static const Vector3& Corner(const Triangle& triangle, unsigned index) { return index == 0 ? triangle.a : index == 1 ? triangle.b : triangle.c; }
+
+    // Both windings, four pixels of a row per step. Only pixels the triangle fully covers are written,
+    // except across shared edges where the neighbour covers the rest, so meshes leave no cracks.
+    void Rasterize(const Projected& a, const Projected& b, const Projected& c, unsigned shared) {
+        const float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        if (Math::Abs(area) < 1e-6f)
+            return;
+        const int x0 = Pixel(Math::Min(a.x, Math::Min(b.x, c.x)), Width) & ~3;
+        const int x1 = Math::Min(Pixel(Math::Max(a.x, Math::Max(b.x, c.x)), Width) + 1, (int)Width);
+        const int y0 = Pixel(Math::Min(a.y, Math::Min(b.y, c.y)), Height);
+        const int y1 = Math::Min(Pixel(Math::Max(a.y, Math::Max(b.y, c.y)), Height) + 1, (int)Height);
+        if ((x0 >= x1) || (y0 >= y1))
+            return;
+        const float sign = area > 0.f ? 1.f : -1.f;
+        const Projected* v[3] = { &a, &b, &c };
+        float ea[3], eb[3], ec[3]; // Edge functions ea * x + eb * y + ec, positive inside.
+        for (unsigned i = 0; i < 3; ++i) {
+            const auto& v0 = *v[i];
+            const auto& v1 = *v[(i + 1) % 3];
+            ea[i] = -(v1.y - v0.y) * sign;
+            eb[i] = (v1.x - v0.x) * sign;
+            ec[i] = -(ea[i] * v0.x + eb[i] * v0.y);
+            if ((shared & (1u << i)) == 0)
+                ec[i] -= 0.5f * (Math::Abs(ea[i]) + Math::Abs(eb[i])); // Inside at the center means inside at every corner.
+        }
+        const float inv_area = 1.f / area;
+        const float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) * inv_area;
+        const float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) * inv_area;
+        const float dz0 = a.z - dzdx * a.x - dzdy * a.y + 0.5f * (Math::Abs(dzdx) + Math::Abs(dzdy)); // Farthest depth over the pixel.
+        const float lanes[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+        const Float4 offsets = Float4::Load(lanes);
+        for (int y = y0; y < y1; ++y) {
+            const float py = (float)y + 0.5f;
+            const Float4 row0(eb[0] * py + ec[0]), row1(eb[1] * py + ec[1]), row2(eb[2] * py + ec[2]);
+            const Float4 row_z(dzdy * py + dz0);
+            float* row = depths->pixels + y * Width;
+            for (int x = x0; x < x1; x += 4) {
+                const Float4 px = Float4((float)x) + offsets;
+                const Float4 e0 = Float4(ea[0]) * px + row0;
+                const Float4 e1 = Float4(ea[1]) * px + row1;
+                const Float4 e2 = Float4(ea[2]) * px + row2;
+                const Float4 inside = e0.Min(e1).Min(e2) >= Float4(0.f);
+                const Float4 current = Float4::Load(row + x);
+                const Float4 z = Float4(dzdx) * px + row_z;
+                Float4::Select(inside, current.Min(z), current).Store(row + x);
+            }
+        }
+    }
+
+    void ReduceTiles() {
+        for (unsigned ty = 0; ty < TileHeight; ++ty) {
+            for (unsigned tx = 0; tx < TileWidth; ++tx) {
+                Float4 farthest(0.f);
+                for (unsigned y = 0; y < TileSize; ++y) {
+                    const float* row = depths->pixels + (ty * TileSize + y) * Width + tx * TileSize;
+                    for (unsigned x = 0; x < TileSize; x += 4)
+                        farthest = farthest.Max(Float4::Load(row + x));
+                }
+                float values[4];
+                farthest.Store(values);
+                depths->tiles[ty * TileWidth + tx] = Math::Max(Math::Max(values[0], values[1]), Math::Max(values[2], values[3]));
+            }
+        }
+    }
+
+public:
+    OcclusionBuffer() {
+        depths = new(Memory::Allocate(sizeof(Depths), Memory::Tag::Occlusion)) Depths();
+    }
+
+    ~OcclusionBuffer() {
+        Memory::Deallocate(depths, sizeof(Depths), Memory::Tag::Occlusion);
+    }
+
+    void Begin(const Matrix& camera_viewproj) {
+        viewproj = camera_viewproj;
+        active = false;
+    }
+
+    static void FindSharedEdges(const Triangle* triangles, unsigned count, uint8* out_shared) { // Bit i set when edge i of a triangle also bounds another one.
+        for (unsigned i = 0; i < count; ++i) {
+            out_shared[i] = 0;
+            for (unsigned e = 0; e < 3; ++e) {
+                const auto& p0 = Corner(triangles[i], e);
+                const auto& p1 = Corner(triangles[i], (e + 1) % 3);
+                for (unsigned j = 0; (j < count) && !(out_shared[i] & (1u << e)); ++j) {
+                    for (unsigned f = 0; (f < 3) && (j != i); ++f) {
+                        const auto& q0 = Corner(triangles[j], f);
+                        const auto& q1 = Corner(triangles[j], (f + 1) % 3);
+                        if (((p0 == q0) && (p1 == q1)) || ((p0 == q1) && (p1 == q0)))
+                            out_shared[i] |= 1u << e;
+                    }
+                }
+            }
+        }
+    }
+
+    void Draw(const Triangle* triangles, const uint8* shared, unsigned count, const Matrix& world) { // World rows map mesh space, as instance boxes do.
+        if (!active) {
+            const Float4 cleared(1.f);
+            for (unsigned i = 0; i < Width * Height; i += 4)
+                cleared.Store(depths->pixels + i);
+        }
+        const Matrix m = world * viewproj;
+        for (unsigned i = 0; i < count; ++i) {
+            Projected a, b, c;
+            if (Project(m, triangles[i].a, a) && Project(m, triangles[i].b, b) && Project(m, triangles[i].c, c)) // Occluders are dropped rather than clipped.
+                Rasterize(a, b, c, shared ? shared[i] : 0);
+        }
+        active = true;
+    }
+
+    void End() {
+        if (active)
+            ReduceTiles();
+    }
+
+    bool IsActive() const { return active; }
+
+    bool IsVisible(const Aabb& box) const { // Visible unless every pixel under its screen rectangle holds a nearer occluder.
+        if (!active)
+            return true;
+        float min_x = Math::Large, min_y = Math::Large, max_x = -Math::Large, max_y = -Math::Large, min_z = Math::Large;
+        for (unsigned i = 0; i < 8; ++i) {
+            const Vector3 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+            Projected p;
+            if (!Project(viewproj, corner, p))
+                return true;
+            min_x = Math::Min(min_x, p.x);
+            min_y = Math::Min(min_y, p.y);
+            max_x = Math::Max(max_x, p.x);
+            max_y = Math::Max(max_y, p.y);
+            min_z = Math::Min(min_z, p.z);
+        }
+        min_z -= DepthBias;
+        const int x0 = Pixel(min_x, Width);
+        const int x1 = Math::Min(Pixel(max_x, Width) + 1, (int)Width);
+        const int y0 = Pixel(min_y, Height);
+        const int y1 = Math::Min(Pixel(max_y, Height) + 1, (int)Height);
+        if ((x0 >= x1) || (y0 >= y1))
+            return true;
+        for (int ty = y0 / (int)TileSize; ty <= (y1 - 1) / (int)TileSize; ++ty) {
+            for (int tx = x0 / (int)TileSize; tx <= (x1 - 1) / (int)TileSize; ++tx) {
+                if (depths->tiles[ty * TileWidth + tx] < min_z)
+                    continue;
+                const int px0 = Math::Max(x0, tx * (int)TileSize), px1 = Math::Min(x1, (tx + 1) * (int)TileSize);
+                const int py0 = Math::Max(y0, ty * (int)TileSize), py1 = Math::Min(y1, (ty + 1) * (int)TileSize);
+                for (int y = py0; y < py1; ++y)
+                    for (int x = px0; x < px1; ++x)
+                        if (depths->pixels[y * Width + x] >= min_z)
+                            return true;
+            }
+        }
+        return false;
+    }
+};
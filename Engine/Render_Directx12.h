@@ -426,6 +426,7 @@ private:
     UINT default_texture_index = 0;
     UINT frame_index = 0;
     Vector2 dynamic_scale = Vector2(1.f);
+    const Bundle* names = nullptr; // Debug object names, hex ids are used when the bundle has none.
 
     void InitDevice() {
         UINT dxgi_factory_flags = 0;
@@ -588,6 +589,18 @@ public:
         object->SetName(wide_name);
     }
 
+    void SetDebugName(ID3D12Object* object, const char* kind, uint64 id, const char* usage) const {
+        char name[String::MaxSize];
+        const char* data_name = names ? names->FindName(id) : nullptr;
+        const int result = data_name ?
+            snprintf(name, String::MaxSize, "%s %s %s", kind, data_name, usage) :
+            snprintf(name, String::MaxSize, "%s %016llx %s", kind, id, usage);
+        if (result < 0) throw Exception();
+        SetDebugName(object, String(name));
+    }
+
+    void SetNames(const Bundle& bundle) { names = &bundle; }
+
     Context() {}
     Context(const Parameters& parameters)
     : window(parameters) {
@@ -663,6 +676,11 @@ public:
     DescriptorPool& UAVPool() { return cbv_srv_uav_pool; }
 
     Microsoft::WRL::ComPtr<ID3D12Device> Device() { return device; }
+
+    size ResourceSize(ID3D12Resource* resource) {
+        const auto desc = resource->GetDesc();
+        return device->GetResourceAllocationInfo(0, 1, &desc).SizeInBytes;
+    }
     Microsoft::WRL::ComPtr<IDXGISwapChain3>& SwapChain() { return swap_chain; };
     Microsoft::WRL::ComPtr<ID3D12CommandQueue>& CommandQueue() { return command_queue; };
 
@@ -715,15 +733,25 @@ class Buffer : public NoCopy {
     Microsoft::WRL::ComPtr<ID3D12Resource> resource;
     uint64 gpu = 0;
     uint8* cpu = nullptr;
+    size gpu_size = 0;
+    Memory::Tag tag = Memory::Tag::None;
 
 public:
     Buffer() {}
-    Buffer(Context& context, size size) {
+    Buffer(Context& context, size size, Memory::Tag tag)
+        : tag(tag) {
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &ResourceDesc::Buffer(size), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&(resource))));
         DEBUG_ONLY(resource->SetName(L"Buffer"));
 
         Context::CheckResult(resource->Map(0, &Range(0, 0), (void**)&cpu));
         gpu = resource->GetGPUVirtualAddress();
+        gpu_size = context.ResourceSize(resource.Get());
+        Memory::Track(tag, 0, (int64)gpu_size);
+    }
+
+    ~Buffer() {
+        if (gpu_size > 0)
+            Memory::Track(tag, 0, -(int64)gpu_size);
     }
 
     static constexpr size AlignSize(size u) {
@@ -740,6 +768,7 @@ class MeshDynamic : public Mesh {
     Microsoft::WRL::ComPtr<ID3D12Resource> index_buffer;
     D3D12_VERTEX_BUFFER_VIEW vertex_buffer_view;
     D3D12_INDEX_BUFFER_VIEW index_buffer_view;
+    size gpu_size = 0;
 
     static DXGI_FORMAT Format(Attribute::Type type) {
         switch (type) {
@@ -753,9 +782,11 @@ class MeshDynamic : public Mesh {
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &ResourceDesc::Buffer(vb_size + ib_size), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload_buffer)));
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &ResourceDesc::Buffer(vb_size), D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&vertex_buffer)));
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &ResourceDesc::Buffer(ib_size), D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&index_buffer)));
-        DEBUG_ONLY(Context::SetDebugName(upload_buffer.Get(), String("Mesh ") + Name() + String(" Upload Buffer"));)
-        DEBUG_ONLY(Context::SetDebugName(vertex_buffer.Get(), String("Mesh ") + Name() + String(" Vertex Buffer"));)
-        DEBUG_ONLY(Context::SetDebugName(index_buffer.Get(), String("Mesh ") + Name() + String(" Index Buffer"));)
+        DEBUG_ONLY(context.SetDebugName(upload_buffer.Get(), "Mesh", Id(), "Upload Buffer");)
+        DEBUG_ONLY(context.SetDebugName(vertex_buffer.Get(), "Mesh", Id(), "Vertex Buffer");)
+        DEBUG_ONLY(context.SetDebugName(index_buffer.Get(), "Mesh", Id(), "Index Buffer");)
+        gpu_size = context.ResourceSize(upload_buffer.Get()) + context.ResourceSize(vertex_buffer.Get()) + context.ResourceSize(index_buffer.Get());
+        Memory::Track(Memory::Tag::Mesh, Id(), (int64)gpu_size);
     }
 
     void CreateBufferViews(size vb_size, size ib_size) {
@@ -776,6 +807,11 @@ class MeshDynamic : public Mesh {
     }
 
 public:
+    ~MeshDynamic() {
+        if (gpu_size > 0)
+            Memory::Track(Memory::Tag::Mesh, Id(), -(int64)gpu_size);
+    }
+
     void Load(const Bundle& bundle, Context& context, CommandList& upload_list) {
         const auto asset = bundle.FindData(Id());
         const size vb_size = vertices.Stride() * vertex_count;
@@ -809,13 +845,23 @@ class SurfaceDynamic : public Surface {
     Microsoft::WRL::ComPtr<ID3D12Resource> upload_buffer;
     unsigned surface_index = 0;
     FixedArray<UINT, Context::BufferCount> render_target_index;
+    size buffer_size = 0;
+    size upload_size = 0;
+
+    void TrackSize(size& tracked_size, size new_size) {
+        if (tracked_size > 0)
+            Memory::Track(Memory::Tag::Surface, Id(), -(int64)tracked_size);
+        tracked_size = new_size;
+        Memory::Track(Memory::Tag::Surface, Id(), (int64)tracked_size);
+    }
 
     void CreateBuffer(Context& context, const Surface& surface, unsigned depth_or_array_size, bool is_depth_stencil, bool is_render_target, unsigned mip_count, Vector4 clear_color) {
         const auto resource_desc = ResourceDesc::Tex2D(ResourceFormat(NativeFormat(surface.Format())), surface.Width(), surface.Height(), depth_or_array_size, mip_count, 1, 0, ResourceFlags(is_depth_stencil, is_render_target));
         const auto resource_state = ResourceStates(is_depth_stencil, is_render_target);
         ClearValue clear_value(NativeFormat(surface.Format()), &clear_color.x);
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_DEFAULT), D3D12_HEAP_FLAG_NONE, &resource_desc, resource_state, is_render_target ? &clear_value : nullptr, IID_PPV_ARGS(&surface_buffer)));
-        DEBUG_ONLY(Context::SetDebugName(surface_buffer.Get(), String("Surface ") + surface.Name() + String(" Buffer"));)
+        DEBUG_ONLY(context.SetDebugName(surface_buffer.Get(), "Surface", surface.Id(), "Buffer");)
+        TrackSize(buffer_size, context.ResourceSize(surface_buffer.Get()));
     }
 
     void CreateSRV(Context& context, Dimension dimension, PixelFormat pixel_format, bool is_cube_map, unsigned mip_count) {
@@ -897,7 +943,8 @@ class SurfaceDynamic : public Surface {
         D3D12_RESOURCE_DESC desc = surface_buffer.Get()->GetDesc();
         context.Device()->GetCopyableFootprints(&desc, 0, slice_count * mip_count, 0, nullptr, nullptr, nullptr, &required_size);
         Context::CheckResult(context.Device()->CreateCommittedResource(&HeapProperties(D3D12_HEAP_TYPE_UPLOAD), D3D12_HEAP_FLAG_NONE, &ResourceDesc::Buffer(required_size), D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&upload_buffer)));
-        DEBUG_ONLY(Context::SetDebugName(upload_buffer.Get(), String("Texture ") + Name() + String(" Upload Buffer"));)
+        DEBUG_ONLY(context.SetDebugName(upload_buffer.Get(), "Texture", Id(), "Upload Buffer");)
+        TrackSize(upload_size, context.ResourceSize(upload_buffer.Get()));
 
         const auto asset = bundle.FindData(Id());
         const auto sub_resources = SubResources(asset.Mem());
@@ -1059,6 +1106,13 @@ class SurfaceDynamic : public Surface {
     D3D12_RESOURCE_STATES WriteState() const { return is_depth_stencil ? D3D12_RESOURCE_STATE_DEPTH_WRITE : D3D12_RESOURCE_STATE_RENDER_TARGET; }
 
 public:
+    ~SurfaceDynamic() {
+        if (buffer_size > 0)
+            Memory::Track(Memory::Tag::Surface, Id(), -(int64)buffer_size);
+        if (upload_size > 0)
+            Memory::Track(Memory::Tag::Surface, Id(), -(int64)upload_size);
+    }
+
     void Load(const Bundle& bundle, Context& context, CommandList& upload_list) {
         if (is_texture) {
             CreateBuffer(context, *this, slice_count, false, false, mip_count, Vector4(0.f));
@@ -1363,7 +1417,7 @@ private:
             const auto input_element_descs = InputElementDescs(shader.inputs);
             const auto pso_desc = GraphicsPipelineStateDesc(context, technique, input_element_descs, data);
             Context::CheckResult(context.Device()->CreateGraphicsPipelineState(&pso_desc, IID_PPV_ARGS(&pipeline_state)));
-            DEBUG_ONLY(Context::SetDebugName(pipeline_state.Get(), String("Shader ") + shader.Name() + String(" Graphics Pipeline State"));)
+            DEBUG_ONLY(context.SetDebugName(pipeline_state.Get(), "Shader", shader.Id(), "Graphics Pipeline State");)
         }
 
         Array<DescriptorRange, Camera::SurfaceMaxCount> DescriptorRanges(const Array<Descriptor, DescriptorMaxCount>& descriptors) {
@@ -1647,7 +1701,7 @@ public:
         if ((gpu_begin != 0) && (gpu_end != 0)) {
             const uint64 cpu_begin = cpu + (gpu_begin - gpu) * 1000000 / gpu_frequency;
             const uint64 cpu_end = cpu + (gpu_end - gpu) * 1000000 / gpu_frequency;
-            DEBUG_ONLY(profile.BeginEndGPU(cpu_begin, cpu_end, color);)
+            PROFILE_ONLY(profile.BeginEndGPU(cpu_begin, cpu_end, color);)
             frame_total += cpu_end - cpu_begin;
         }
         gather_count[gather_index] += 2;
@@ -57,6 +57,9 @@ public:
     void Stop() {
     }
     
+    void SetNames(const Bundle& bundle) {
+    }
+    
     void Swap() {
     }
     
@@ -123,7 +126,7 @@ class Buffer : public NoCopy {
     uint8* cpu = nullptr;
     
 public:
-    Buffer(Context& context, size size) {
+    Buffer(Context& context, size size, Memory::Tag tag) {
     }
     
     uint64 GPU() const { return gpu; }
@@ -136,8 +139,8 @@ public:
 
 class MeshDynamic : public Mesh {
 public:
-    MeshDynamic(uint64 id, const String& name)
-    : Mesh(id, name) {}
+    MeshDynamic(uint64 id)
+    : Mesh(id) {}
     
     void Load(Bundle& bundle, Context& context, CommandList& upload_list) {
     }